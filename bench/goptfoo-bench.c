@@ -0,0 +1,450 @@
+/* goptfoo-bench - times the goptfoo(3) parsers on generated input and
+ * prints tab-separated results: ns/value, MB/s, and how many times the
+ * parser allocated per call. run via `make bench`, save the output with
+ * -o, and a later run with -b compares itself against that baseline:
+ *
+ *   make bench BENCHFLAGS="-o before.tsv"
+ *   ... hack on lib/goptfoo.c ...
+ *   make bench BENCHFLAGS="-b before.tsv -r 10"
+ *
+ * the input is generated from a fixed seed so that runs are comparable */
+
+#ifdef __linux__
+#include <getopt.h>
+#endif
+
+#include <err.h>
+#include <float.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <goptfoo.h>
+
+#define MAX_BASELINE 256
+#define SHORT_CALLS 100000
+
+/* count the allocations the library makes by standing in front of the
+ * glibc allocator; elsewhere the counts are reported as "-" */
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static unsigned long allocs;
+
+void *malloc(size_t size)
+{
+    allocs++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    allocs++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    allocs++;
+    return __libc_realloc(ptr, size);
+}
+
+#define COUNT_ALLOCS 1
+#endif
+
+enum {
+    ARGTOD, ARGTOLL, ARGTOUL, FLAGTOD, FLAGTOLL, FLAGTOUL,
+    FLAGTOLODS, FLAGTOLOLLS, FLAGTOLOULS, FLAGTOLOFS, FLAGTOLOI32S,
+    FLAGTOLOI16S, FLAGTOLOU32S, FLAGTOLOU8S
+};
+
+static const char *fnames[] = {
+    "argtod", "argtoll", "argtoul", "flagtod", "flagtoll", "flagtoul",
+    "flagtolods", "flagtololls", "flagtolouls", "flagtolofs",
+    "flagtoloi32s", "flagtoloi16s", "flagtolou32s", "flagtolou8s"
+};
+
+enum {
+    DEC_LL, HEX_LL, DEC_UL, HEX_UL, SHORT_D, WORST_D, DEC_I32, DEC_I16,
+    DEC_U32, DEC_U8
+};
+
+struct base {
+    char name[64];
+    char fname[16];
+    double ns;
+};
+
+struct base baseline[MAX_BASELINE];
+size_t numbase;
+
+FILE *out;
+double Flag_Mintime = 0.25;     /* -t */
+double Flag_Regress = -1;       /* -r */
+unsigned long Flag_Maxitems = 10000000; /* -n */
+int regressions;
+
+uint64_t seed = 0x9e3779b97f4a7c15ULL;
+
+volatile double sink;
+
+void compare(const char *name, const char *fname, double ns);
+char *corpus(int kind, size_t count, size_t *len);
+void emit_help(void);
+void load_baseline(const char *path);
+double now(void);
+void run(const char *name, int fn, const char *arg, size_t values);
+uint64_t rand64(void);
+
+int main(int argc, char *argv[])
+{
+    static const struct {
+        const char *name;
+        int kind;
+        int fn;
+    } lists[] = {
+        {"dec", DEC_LL, FLAGTOLOLLS},
+        {"hex", HEX_LL, FLAGTOLOLLS},
+        {"dec", DEC_UL, FLAGTOLOULS},
+        {"hex", HEX_UL, FLAGTOLOULS},
+        {"short", SHORT_D, FLAGTOLODS},
+        {"worst", WORST_D, FLAGTOLODS},
+        {"short", SHORT_D, FLAGTOLOFS},
+        {"dec", DEC_I32, FLAGTOLOI32S},
+        {"dec", DEC_I16, FLAGTOLOI16S},
+        {"dec", DEC_U32, FLAGTOLOU32S},
+        {"dec", DEC_U8, FLAGTOLOU8S},
+    };
+    static const struct {
+        const char *name;
+        size_t count;
+    } sizes[] = {
+        {"1e3", 1000},
+        {"1e6", 1000000},
+        {"1e7", 10000000},
+    };
+    char name[64], *arg;
+    int ch;
+    size_t len;
+
+    out = stdout;
+
+    while ((ch = getopt(argc, argv, "h?b:n:o:r:t:")) != -1) {
+        switch (ch) {
+        case 'b':
+            load_baseline(optarg);
+            break;
+        case 'n':
+            Flag_Maxitems = flagtoul(ch, optarg, 1UL, ULONG_MAX);
+            break;
+        case 'o':
+            if ((out = fopen(optarg, "w")) == NULL)
+                err(EX_CANTCREAT, "could not open '%s'", optarg);
+            break;
+        case 'r':
+            Flag_Regress = flagtod(ch, optarg, 0.0, 1000.0);
+            break;
+        case 't':
+            Flag_Mintime = flagtod(ch, optarg, 0.0, 60.0);
+            break;
+        case 'h':
+        case '?':
+        default:
+            emit_help();
+            /* NOTREACHED */
+        }
+    }
+
+    fprintf(out, "# case\tfunction\tvalues\tbytes\tns_value\tmb_s\tallocs%s\n",
+            numbase ? "\tbase_ns_value\tchange_pct" : "");
+
+    run("short-dec", ARGTOD, "0.4375", 1);
+    run("short-dec", ARGTOLL, "-4096", 1);
+    run("short-hex", ARGTOUL, "0x1f40", 1);
+    run("short-dec", FLAGTOD, "2.5e-3", 1);
+    run("short-dec", FLAGTOLL, "65535", 1);
+    run("short-hex", FLAGTOUL, "0xdeadbeef", 1);
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        if (sizes[s].count > Flag_Maxitems)
+            break;
+        for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+            arg = corpus(lists[i].kind, sizes[s].count, &len);
+            snprintf(name, sizeof(name), "list-%s-%s", sizes[s].name,
+                     lists[i].name);
+            run(name, lists[i].fn, arg, sizes[s].count);
+            free(arg);
+        }
+    }
+
+    if (out != stdout && fclose(out) != 0)
+        err(EX_IOERR, "could not write results");
+    if (Flag_Regress >= 0 && regressions > 0)
+        errx(1, "%d regression%s above %g%%", regressions,
+             regressions == 1 ? "" : "s", Flag_Regress);
+    exit(EXIT_SUCCESS);
+}
+
+void compare(const char *name, const char *fname, double ns)
+{
+    double change;
+
+    for (size_t i = 0; i < numbase; i++) {
+        if (strcmp(baseline[i].name, name) == 0
+            && strcmp(baseline[i].fname, fname) == 0) {
+            change = (ns - baseline[i].ns) / baseline[i].ns * 100.0;
+            fprintf(out, "\t%.2f\t%+.1f", baseline[i].ns, change);
+            if (Flag_Regress >= 0 && change > Flag_Regress) {
+                warnx("%s %s is %.1f%% slower", name, fname, change);
+                regressions++;
+            }
+            return;
+        }
+    }
+    fputs("\t-\t-", out);
+}
+
+/* generate count whitespace separated values of the given kind */
+char *corpus(int kind, size_t count, size_t *len)
+{
+    char *buf, *p;
+    size_t size;
+    uint64_t r;
+
+    /* the longest token is a worst case double, under 48 bytes */
+    size = count * 48 + 1;
+    if ((buf = malloc(size)) == NULL)
+        err(EX_OSERR, "could not allocate %zu bytes of input", size);
+    p = buf;
+    for (size_t i = 0; i < count; i++) {
+        r = rand64();
+        switch (kind) {
+        case DEC_LL:
+            p += sprintf(p, "%lld ", (long long) (r >> 24) - (1LL << 39));
+            break;
+        case HEX_LL:
+            p += sprintf(p, "0x%llx ", (unsigned long long) (r >> (1 + (r & 31))));
+            break;
+        case DEC_UL:
+            p += sprintf(p, "%lu ", (unsigned long) (r >> (r & 31)));
+            break;
+        case HEX_UL:
+            p += sprintf(p, "0x%lx ", (unsigned long) (r >> (r & 31)));
+            break;
+        case SHORT_D:
+            p += sprintf(p, "%.3f ", (double) (r >> 11) / (1 << 21));
+            break;
+        case DEC_I32:
+            p += sprintf(p, "%ld ", (long) (int32_t) (r >> 32));
+            break;
+        case DEC_I16:
+            p += sprintf(p, "%d ", (int) (int16_t) (r >> 48));
+            break;
+        case DEC_U32:
+            p += sprintf(p, "%lu ", (unsigned long) (uint32_t) (r >> 32));
+            break;
+        case DEC_U8:
+            p += sprintf(p, "%u ", (unsigned int) (r >> 56));
+            break;
+        case WORST_D:{
+                /* near the midpoint between two doubles, so that the
+                 * fast paths cannot decide and must fall back */
+                double d = (double) (r >> 11) * 0x1p-40, next;
+#if LDBL_MANT_DIG > DBL_MANT_DIG
+                uint64_t bits;
+                memcpy(&bits, &d, sizeof(d));
+                bits++;
+                memcpy(&next, &bits, sizeof(next));
+                p += sprintf(p, "%.24Le ",
+                             ((long double) d + (long double) next) / 2);
+#else
+                (void) next;
+                p += sprintf(p, "%.16e ", d);
+#endif
+                break;
+            }
+        }
+    }
+    *--p = '\0';
+    *len = (size_t) (p - buf);
+    return buf;
+}
+
+void emit_help(void)
+{
+    fprintf(stderr,
+            "Usage: goptfoo-bench [-b baseline] [-n maxitems] [-o output]\n"
+            "                     [-r percent] [-t seconds]\n");
+    exit(EX_USAGE);
+}
+
+void load_baseline(const char *path)
+{
+    char line[256];
+    FILE *fh;
+    struct base *b;
+
+    if ((fh = fopen(path, "r")) == NULL)
+        err(EX_NOINPUT, "could not open '%s'", path);
+    while (fgets(line, sizeof(line), fh)) {
+        if (*line == '#')
+            continue;
+        if (numbase >= MAX_BASELINE)
+            errx(EX_DATAERR, "too many lines in '%s'", path);
+        b = &baseline[numbase];
+        if (sscanf(line, "%63s %15s %*s %*s %lf", b->name, b->fname,
+                   &b->ns) != 3 || b->ns <= 0)
+            errx(EX_DATAERR, "could not parse '%s' line %zu", path,
+                 numbase + 1);
+        numbase++;
+    }
+    fclose(fh);
+}
+
+double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/* time fn on arg until at least Flag_Mintime has passed over three or
+ * more runs, or a single run took longer than that, and report the best
+ * run. the single value functions are called SHORT_CALLS times a run */
+void run(const char *name, int fn, const char *arg, size_t values)
+{
+    double best = 0, elapsed, start, total = 0;
+    double *dl;
+    long long *ll;
+    float *fl;
+    int32_t *i32;
+    int16_t *i16;
+    uint32_t *u32;
+    uint8_t *u8;
+    unsigned long *ul, calls = 1, runs = 0, used = 0;
+    size_t bytes = strlen(arg);
+
+    if (fn < FLAGTOLODS) {
+        calls = SHORT_CALLS;
+        values *= calls;
+        bytes *= calls;
+    }
+
+    while (runs < 3 || total < Flag_Mintime) {
+        dl = NULL;
+        ll = NULL;
+        ul = NULL;
+        fl = NULL;
+        i32 = NULL;
+        i16 = NULL;
+        u32 = NULL;
+        u8 = NULL;
+#ifdef COUNT_ALLOCS
+        allocs = 0;
+#endif
+        start = now();
+        switch (fn) {
+        case ARGTOD:
+            for (unsigned long i = 0; i < calls; i++)
+                sink = argtod("bench", arg, -INFINITY, INFINITY);
+            break;
+        case ARGTOLL:
+            for (unsigned long i = 0; i < calls; i++)
+                sink = argtoll("bench", arg, LLONG_MIN, LLONG_MAX);
+            break;
+        case ARGTOUL:
+            for (unsigned long i = 0; i < calls; i++)
+                sink = argtoul("bench", arg, 0UL, ULONG_MAX);
+            break;
+        case FLAGTOD:
+            for (unsigned long i = 0; i < calls; i++)
+                sink = flagtod('b', arg, -INFINITY, INFINITY);
+            break;
+        case FLAGTOLL:
+            for (unsigned long i = 0; i < calls; i++)
+                sink = flagtoll('b', arg, LLONG_MIN, LLONG_MAX);
+            break;
+        case FLAGTOUL:
+            for (unsigned long i = 0; i < calls; i++)
+                sink = flagtoul('b', arg, 0UL, ULONG_MAX);
+            break;
+        case FLAGTOLODS:
+            sink = flagtolods('b', arg, -INFINITY, INFINITY, &dl, NULL,
+                              0, 0);
+            break;
+        case FLAGTOLOLLS:
+            sink = flagtololls('b', arg, LLONG_MIN, LLONG_MAX, &ll, NULL,
+                               0, 0);
+            break;
+        case FLAGTOLOULS:
+            sink = flagtolouls('b', arg, 0UL, ULONG_MAX, &ul, NULL, 0, 0);
+            break;
+        case FLAGTOLOFS:
+            sink = flagtolofs('b', arg, -INFINITY, INFINITY, &fl, NULL,
+                              0, 0);
+            break;
+        case FLAGTOLOI32S:
+            sink = flagtoloi32s('b', arg, INT32_MIN, INT32_MAX, &i32, NULL,
+                                0, 0);
+            break;
+        case FLAGTOLOI16S:
+            sink = flagtoloi16s('b', arg, INT16_MIN, INT16_MAX, &i16, NULL,
+                                0, 0);
+            break;
+        case FLAGTOLOU32S:
+            sink = flagtolou32s('b', arg, 0, UINT32_MAX, &u32, NULL, 0, 0);
+            break;
+        case FLAGTOLOU8S:
+            sink = flagtolou8s('b', arg, 0, UINT8_MAX, &u8, NULL, 0, 0);
+            break;
+        }
+        elapsed = now() - start;
+#ifdef COUNT_ALLOCS
+        used = allocs;
+#endif
+        free(dl);
+        free(ll);
+        free(ul);
+        free(fl);
+        free(i32);
+        free(i16);
+        free(u32);
+        free(u8);
+
+        if (runs++ == 0 || elapsed < best)
+            best = elapsed;
+        total += elapsed;
+        if (runs == 1 && elapsed > Flag_Mintime)
+            break;
+    }
+
+    fprintf(out, "%s\t%s\t%zu\t%zu\t%.2f\t%.1f\t", name, fnames[fn],
+            values, bytes, best * 1e9 / (double) values,
+            (double) bytes / best / 1e6);
+#ifdef COUNT_ALLOCS
+    fprintf(out, "%lu", used / calls);
+#else
+    (void) used;
+    fputs("-", out);
+#endif
+    if (numbase)
+        compare(name, fnames[fn], best * 1e9 / (double) values);
+    fputc('\n', out);
+    fflush(out);
+}
+
+/* xorshift64* so that the input is the same from run to run */
+uint64_t rand64(void)
+{
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    return seed * 0x2545f4914f6cdd1dULL;
+}
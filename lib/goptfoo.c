@@ -6,257 +6,6423 @@
  * therefore, negative values are not allowed to the unsigned functions
  * of this library */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/* the library has the real functions that the inline ones fall back to */
+#undef GOPTFOO_INLINE
 #include "goptfoo.h"
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef GOPTFOO_STATS
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#endif
+#if defined(HAVE_X86INTRIN_H) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define GOPTFOO_RDTSC
+#else
+#include <time.h>
+#endif
+#endif
+
+#include <fcntl.h>
+#include <float.h>
+#include <locale.h>
+#include <string.h>
+
+#include "goptfoo_pow5.h"
+
+/* integer scanning *************************************************** */
+
+/* a locale-free replacement for strtoll(3) and strtoul(3) with base 0,
+ * 10, or 16 for the list functions, which call these once per token.
+ * the input need not be NUL terminated; instead the end of the input is
+ * passed so that the SWAR digit loads know how much can safely be read */
+
+#define SCAN_OK 0
+#define SCAN_NONE 1             /* no digits, *ep == start */
+#define SCAN_RANGE 2            /* did not fit, digits still consumed */
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define GOPTFOO_SWAR 1
+#endif
+
+/* isspace(3) and isdigit(3) as the "C" locale has them */
+#define gf_isspace(c) ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+#define gf_isdigit(c) ((unsigned char) ((c) - '0') < 10)
+
+/* for code that is only fast when inlined into its caller */
+#ifdef __GNUC__
+#define gf_inline inline __attribute__((always_inline))
+#else
+#define gf_inline inline
+#endif
+
+static const unsigned char hexval[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+#ifdef GOPTFOO_SWAR
+static const uint64_t pow10u[9] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+};
+
+/* how many of the eight bytes are leading ASCII digits, after "Fast
+ * numeric string to int" by Wojciech Muła and the fast_float library;
+ * the first character must be in the low byte. any carries from the
+ * addition only move up and past the first non-digit, so that byte is
+ * always detected */
+static inline unsigned int swar_ndigits8(uint64_t v)
+{
+    uint64_t t = ((v & 0xF0F0F0F0F0F0F0F0ULL) |
+                  (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >>
+                   4)) ^ 0x3333333333333333ULL;
+    return t ? (unsigned int) __builtin_ctzll(t) >> 3 : 8;
+}
+
+/* the value of the leading n (0..8) digits; the digits are shifted up
+ * so the discarded high bytes become leading zeros. the shift is done
+ * in two halves so that n of zero (a shift by 64) gives zero */
+static inline uint64_t swar_digits8(uint64_t v, unsigned int n)
+{
+    const uint64_t mask = 0x000000FF000000FFULL;
+    const uint64_t mul1 = 0x000F424000000064ULL;        /* 100 + (1000000 << 32) */
+    const uint64_t mul2 = 0x0000271000000001ULL;        /* 1 + (10000 << 32) */
+    v -= 0x3030303030303030ULL;
+    v = (v << 4 * (8 - n)) << 4 * (8 - n);
+    v = (v * 10) + (v >> 8);
+    return (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+}
+#endif
+
+/* the digit loops, each of which may assume that there is at least one
+ * digit. like strto*(3) all the digits are consumed even on overflow */
+static gf_inline int scan_dec(const char *p, const char *end,
+                              const char **ep, uint64_t * mag)
+{
+    /* at most 19 decimal digits always fit; beyond that each digit
+     * needs an overflow check. leading zeros only make the checks
+     * start sooner */
+    uint64_t v = 0;
+    unsigned int d;
+    size_t nd = 0;
+    int ovf = 0;
+#ifdef GOPTFOO_SWAR
+    uint64_t chunk;
+    unsigned int n;
+    while (end - p >= 8) {
+        memcpy(&chunk, p, sizeof(chunk));
+        n = swar_ndigits8(chunk);
+        if (n == 0 || nd + n > 19)
+            break;
+        v = v * pow10u[n] + swar_digits8(chunk, n);
+        p += n;
+        nd += n;
+        if (n < 8)
+            break;
+    }
+#endif
+    while (p < end && gf_isdigit(*p)) {
+        d = (unsigned int) (*p - '0');
+        if (nd < 19)
+            v = v * 10 + d;
+        else if (ovf || v > (UINT64_MAX - d) / 10)
+            ovf = 1;
+        else
+            v = v * 10 + d;
+        p++;
+        nd++;
+    }
+    *ep = p;
+    *mag = v;
+    return ovf ? SCAN_RANGE : SCAN_OK;
+}
+
+static gf_inline int scan_hex(const char *p, const char *end,
+                              const char **ep, uint64_t * mag)
+{
+    uint64_t v = 0;
+    unsigned int d;
+    int ovf = 0;
+
+    while (p < end && (d = hexval[(unsigned char) *p])) {
+        if (v >> 60)
+            ovf = 1;
+        else
+            v = (v << 4) | (d - 1);
+        p++;
+    }
+    *ep = p;
+    *mag = v;
+    return ovf ? SCAN_RANGE : SCAN_OK;
+}
+
+/* the digits after the leading 0, of which there may be none */
+static gf_inline int scan_oct(const char *p, const char *end,
+                              const char **ep, uint64_t * mag)
+{
+    uint64_t v = 0;
+    int ovf = 0;
+
+    while (p < end && (unsigned char) (*p - '0') < 8) {
+        if (v >> 61)
+            ovf = 1;
+        else
+            v = (v << 3) | (unsigned int) (*p - '0');
+        p++;
+    }
+    *ep = p;
+    *mag = v;
+    return ovf ? SCAN_RANGE : SCAN_OK;
+}
+
+/* the radix is 0 for the prefixes of strto*(3) base 0, 10 for decimal
+ * alone, or 16 for hex with or without a leading "0x". the list loops
+ * pass it as a constant, so that each gets its own kernel without the
+ * tests for the other radixes */
+#define gf_isradix(c, radix) \
+    ((radix) == 16 ? hexval[(unsigned char) (c)] != 0 : gf_isdigit(c))
+
+static int flags_radix(const unsigned int flags)
+{
+    return flags & GOPTFOO_HEX ? 16 : flags & GOPTFOO_DEC ? 10 : 0;
+}
+
+/* the unsigned magnitude of a number, minus any sign. "0x" without any
+ * hex digits after it is a zero followed by junk at the 'x' */
+static gf_inline int scan_mag(const char *p, const char *end,
+                              const char **ep, uint64_t * mag,
+                              const int radix)
+{
+    if (p == end || !gf_isradix(*p, radix)) {
+        *ep = p;
+        return SCAN_NONE;
+    }
+    if (radix == 10)
+        return scan_dec(p, end, ep, mag);
+    if (*p == '0' && end - p >= 3 && (p[1] == 'x' || p[1] == 'X')
+        && hexval[(unsigned char) p[2]])
+        return scan_hex(p + 2, end, ep, mag);
+    if (radix == 16)
+        return scan_hex(p, end, ep, mag);
+    if (*p == '0')
+        return scan_oct(p + 1, end, ep, mag);
+    return scan_dec(p, end, ep, mag);
+}
+
+/* strtoll(3), less the leading whitespace skip */
+static gf_inline int scan_ll(const char *p, const char *end,
+                             const char **ep, long long *value,
+                             const int radix)
+{
+    const char *start = p;
+    uint64_t mag;
+    int neg = 0, ret;
+
+    if (p < end && (*p == '+' || *p == '-'))
+        neg = *p++ == '-';
+    if ((ret = scan_mag(p, end, ep, &mag, radix)) == SCAN_NONE) {
+        *ep = start;
+        return ret;
+    }
+    if (neg) {
+        if (ret == SCAN_RANGE || mag > (uint64_t) LLONG_MAX + 1) {
+            *value = LLONG_MIN;
+            return SCAN_RANGE;
+        }
+        *value = mag ? -(long long) (mag - 1) - 1 : 0;
+    } else {
+        if (ret == SCAN_RANGE || mag > (uint64_t) LLONG_MAX) {
+            *value = LLONG_MAX;
+            return SCAN_RANGE;
+        }
+        *value = (long long) mag;
+    }
+    return SCAN_OK;
+}
+
+/* strtoul(3) for input already checked to not be negative */
+static gf_inline int scan_ul(const char *p, const char *end,
+                             const char **ep, unsigned long *value,
+                             const int radix)
+{
+    const char *start = p;
+    uint64_t mag;
+    int ret;
+
+    if (p < end && *p == '+')
+        p++;
+    if ((ret = scan_mag(p, end, ep, &mag, radix)) == SCAN_NONE) {
+        *ep = start;
+        return ret;
+    }
+    if (ret == SCAN_RANGE || mag > ULONG_MAX) {
+        *value = ULONG_MAX;
+        return SCAN_RANGE;
+    }
+    *value = (unsigned long) mag;
+    return SCAN_OK;
+}
+
+/* double scanning **************************************************** */
+
+/* strtod(3) is locale dependent (a LC_NUMERIC with a comma radix will
+ * stop at the '.' of "0.95") and slow, so decimal input is instead
+ * converted via the Clinger fast path or the Eisel-Lemire algorithm, as
+ * done by the fast_float library. anything else (hex floats, inf, nan,
+ * subnormals, overflow, too many digits to decide) falls back to
+ * strtod(3) on a copy of the token with the '.' adjusted for the
+ * locale. results match strtod(3) in the "C" locale, assuming the
+ * default round-to-nearest mode */
+
+#define SCAN_NOMEM 3            /* fallback could not copy the token */
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+#define GOPTFOO_CLINGER 1
+static const double pow10d[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#endif
+
+static inline uint64_t mul128(uint64_t a, uint64_t b, uint64_t * lo)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ unsigned __int128 r = (unsigned __int128) a * b;
+    *lo = (uint64_t) r;
+    return (uint64_t) (r >> 64);
+#else
+    uint64_t al = a & 0xFFFFFFFF, ah = a >> 32;
+    uint64_t bl = b & 0xFFFFFFFF, bh = b >> 32;
+    uint64_t ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+    uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+    *lo = (mid << 32) | (ll & 0xFFFFFFFF);
+    return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+/* w * 10^q as a double for a non-zero w. returns -1 when the result
+ * would be subnormal, zero, or infinite so that strtod(3) can supply
+ * those along with the ERANGE it sets for them */
+static int eisel_lemire(int64_t q, uint64_t w, double *value)
+{
+    uint64_t hi, lo, hi2, lo2, mant, bits;
+    int lz, upperbit, shift;
+    int64_t power2;
+    size_t idx;
+
+    if (q < POW5_MIN_EXP || q > POW5_MAX_EXP)
+        return -1;
+
+    lz = __builtin_clzll(w);
+    w <<= lz;
+    idx = (size_t) (2 * (q - POW5_MIN_EXP));
+    hi = mul128(w, pow5_128[idx], &lo);
+    /* 55 bits of precision are needed; only when the bits below those
+     * are all set might the low word of the power change the answer */
+    if ((hi & 0x1FF) == 0x1FF) {
+        hi2 = mul128(w, pow5_128[idx + 1], &lo2);
+        lo += hi2;
+        if (hi2 > lo)
+            hi++;
+    }
+
+    upperbit = (int) (hi >> 63);
+    shift = upperbit + 64 - 52 - 3;
+    mant = hi >> shift;
+    /* floor(log2(10^q)) + 63, plus the exponent bias */
+    power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+    if (power2 <= 0)
+        return -1;
+
+    /* exactly halfway between two doubles: round to even */
+    if (lo <= 1 && q >= -4 && q <= 23 && (mant & 3) == 1
+        && (mant << shift) == hi)
+        mant &= ~(uint64_t) 1;
+    mant += mant & 1;
+    mant >>= 1;
+    if (mant >= (uint64_t) 2 << 52) {
+        mant = (uint64_t) 1 << 52;
+        power2++;
+    }
+    mant &= ~((uint64_t) 1 << 52);
+    if (power2 >= 0x7FF)
+        return -1;
+
+    bits = mant | (uint64_t) power2 << 52;
+    memcpy(value, &bits, sizeof(bits));
+    return 0;
+}
+
+/* strtod(3) on a NUL terminated copy of the token at p so that input
+ * that is not NUL terminated can also be handled, and with the '.'
+ * swapped for whatever the locale uses as the radix character. with
+ * single, strtof(3) instead */
+static int scan_fd_slow(const char *p, const char *end, const char **ep,
+                        double *value, const int single)
+{
+    char buf[128], *copy = buf, *cep;
+    const char *radix = localeconv()->decimal_point;
+    size_t len = 0, rlen = strlen(radix), dot = SIZE_MAX, used;
+    int ret = SCAN_OK, saved = errno;
+
+    /* a superset of what strtod(3) might consume */
+    while (p + len < end) {
+        unsigned char c = (unsigned char) p[len];
+        if (!(gf_isdigit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z')
+              || c == '.' || c == '+' || c == '-' || c == '(' || c == ')'
+              || c == '_'))
+            break;
+        if (c == '.' && dot == SIZE_MAX)
+            dot = len;
+        len++;
+    }
+    if (len + rlen + 1 > sizeof(buf) && (copy = malloc(len + rlen + 1)) == NULL)
+        return SCAN_NOMEM;
+    if (dot == SIZE_MAX || (rlen == 1 && *radix == '.')) {
+        memcpy(copy, p, len);
+        copy[len] = '\0';
+        dot = SIZE_MAX;
+    } else {
+        memcpy(copy, p, dot);
+        memcpy(copy + dot, radix, rlen);
+        memcpy(copy + dot + rlen, p + dot + 1, len - dot - 1);
+        copy[len - 1 + rlen] = '\0';
+    }
+
+    errno = 0;
+    *value = single ? strtof(copy, &cep) : strtod(copy, &cep);
+    if (errno == ERANGE)
+        ret = SCAN_RANGE;
+    used = (size_t) (cep - copy);
+    if (dot != SIZE_MAX && used > dot)
+        used -= rlen - 1;
+    if (used == 0)
+        ret = SCAN_NONE;
+    *ep = p + used;
+
+    if (copy != buf)
+        free(copy);
+    errno = saved;
+    return ret;
+}
+
+/* strtod(3), less the leading whitespace skip */
+static int scan_d(const char *p, const char *end, const char **ep,
+                  double *value)
+{
+    const char *start = p;
+    uint64_t w = 0;
+    int64_t exp10 = 0;
+    unsigned int nd = 0;        /* significant digits in w */
+    int neg = 0, any = 0, trunc = 0;
+    double d, d1;
+
+    if (p < end && (*p == '+' || *p == '-'))
+        neg = *p++ == '-';
+    if (p == end || !(gf_isdigit(*p) || *p == '.')
+        || (*p == '0' && end - p >= 2 && (p[1] | 0x20) == 'x'))
+        goto SLOW;
+
+    while (p < end && *p == '0') {
+        p++;
+        any = 1;
+    }
+    while (p < end && gf_isdigit(*p)) {
+        if (nd < 19) {
+            w = w * 10 + (unsigned int) (*p - '0');
+            nd++;
+        } else {
+            exp10++;
+            trunc |= *p != '0';
+        }
+        p++;
+        any = 1;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        if (nd == 0) {
+            while (p < end && *p == '0') {
+                p++;
+                exp10--;
+                any = 1;
+            }
+        }
+#ifdef GOPTFOO_SWAR
+        {
+            uint64_t chunk;
+            unsigned int n;
+            while (end - p >= 8) {
+                memcpy(&chunk, p, sizeof(chunk));
+                n = swar_ndigits8(chunk);
+                if (n == 0 || nd + n > 19)
+                    break;
+                w = w * pow10u[n] + swar_digits8(chunk, n);
+                p += n;
+                nd += n;
+                exp10 -= n;
+                any = 1;
+                if (n < 8)
+                    break;
+            }
+        }
+#endif
+        while (p < end && gf_isdigit(*p)) {
+            if (nd < 19) {
+                w = w * 10 + (unsigned int) (*p - '0');
+                nd++;
+                exp10--;
+            } else {
+                trunc |= *p != '0';
+            }
+            p++;
+            any = 1;
+        }
+    }
+    if (!any) {
+        *ep = start;
+        return SCAN_NONE;
+    }
+    /* an 'e' without digits after it is not part of the number */
+    if (p < end && (*p | 0x20) == 'e') {
+        const char *q = p + 1;
+        int eneg = 0;
+        int64_t e = 0;
+        if (q < end && (*q == '+' || *q == '-'))
+            eneg = *q++ == '-';
+        if (q < end && gf_isdigit(*q)) {
+            while (q < end && gf_isdigit(*q)) {
+                if (e < 100000)
+                    e = e * 10 + (*q - '0');
+                q++;
+            }
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    if (w == 0) {
+        d = 0.0;
+        goto DONE;
+    }
+#ifdef GOPTFOO_CLINGER
+    if (!trunc && w <= (uint64_t) 1 << 53 && exp10 >= -22 && exp10 <= 22) {
+        d = (double) w;
+        d = exp10 < 0 ? d / pow10d[-exp10] : d * pow10d[exp10];
+        goto DONE;
+    }
+#endif
+    if (eisel_lemire(exp10, w, &d) != 0)
+        goto SLOW;
+    /* with digits dropped the value lies between w and w + 1 */
+    if (trunc && (eisel_lemire(exp10, w + 1, &d1) != 0 || d != d1))
+        goto SLOW;
+
+  DONE:
+    *ep = p;
+    *value = neg ? -d : d;
+    return SCAN_OK;
+
+  SLOW:
+    return scan_fd_slow(start, end, ep, value, 0);
+}
+
+/* stats ************************************************************** */
+
+/* with --enable-stats the exiting functions and the list parsing count
+ * their calls, input, values, reallocs, and time into process-wide
+ * counters, and fire USDT probes goptfoo:start, goptfoo:done, and
+ * goptfoo:realloc where <sys/sdt.h> is available. otherwise the STATS_*
+ * macros are empty and none of this is compiled in */
+
+#ifdef GOPTFOO_STATS
+static struct goptfoo_counters counters[GOPTFOO_STATS_KINDS];
+
+#ifdef __GNUC__
+#define STATS_ADD(kind, field, n)                                       \
+    __atomic_fetch_add(&counters[kind].field, (uint64_t) (n),           \
+                       __ATOMIC_RELAXED)
+#define STATS_GET(kind, field)                                          \
+    __atomic_load_n(&counters[kind].field, __ATOMIC_RELAXED)
+#else
+#define STATS_ADD(kind, field, n) (counters[kind].field += (uint64_t) (n))
+#define STATS_GET(kind, field) (counters[kind].field)
+#endif
+
+#ifdef HAVE_SYS_SDT_H
+#define GF_PROBE1(name, a) DTRACE_PROBE1(goptfoo, name, a)
+#define GF_PROBE4(name, a, b, c, d) DTRACE_PROBE4(goptfoo, name, a, b, c, d)
+#else
+#define GF_PROBE1(name, a) ((void) (a))
+#define GF_PROBE4(name, a, b, c, d)
+#endif
+
+static const char *const stats_names[GOPTFOO_STATS_KINDS] = {
+    [GOPTFOO_STATS_ARG] = "arg",
+    [GOPTFOO_STATS_FLAG] = "flag",
+    [GOPTFOO_STATS_LIST] = "list",
+};
+
+static inline uint64_t stats_clock(void)
+{
+#ifdef GOPTFOO_RDTSC
+    return (uint64_t) __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000U + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static void stats_dump(void)
+{
+    struct goptfoo_counters c[GOPTFOO_STATS_KINDS];
+    int kind;
+
+    goptfoo_stats(c);
+    for (kind = 0; kind < GOPTFOO_STATS_KINDS; kind++)
+        fprintf(stderr,
+                "goptfoo: %s calls %llu bytes %llu values %llu reallocs %llu"
+                " realloc_bytes %llu cycles %llu\n", stats_names[kind],
+                (unsigned long long) c[kind].calls,
+                (unsigned long long) c[kind].bytes,
+                (unsigned long long) c[kind].values,
+                (unsigned long long) c[kind].reallocs,
+                (unsigned long long) c[kind].realloc_bytes,
+                (unsigned long long) c[kind].cycles);
+}
+
+static inline uint64_t stats_start(const int kind)
+{
+    GF_PROBE1(start, kind);
+    return stats_clock();
+}
+
+static void stats_end(const int kind, const uint64_t start,
+                      const size_t bytes, const size_t values)
+{
+    static int once;
+    uint64_t cycles = stats_clock() - start;
+
+#ifdef __GNUC__
+    if (!__atomic_load_n(&once, __ATOMIC_RELAXED)
+        && !__atomic_exchange_n(&once, 1, __ATOMIC_RELAXED)
+#else
+    if (!once && (once = 1)
+#endif
+        && getenv("GOPTFOO_STATS"))
+        atexit(stats_dump);
+    STATS_ADD(kind, calls, 1);
+    STATS_ADD(kind, bytes, bytes);
+    STATS_ADD(kind, values, values);
+    STATS_ADD(kind, cycles, cycles);
+    GF_PROBE4(done, kind, bytes, values, cycles);
+}
+
+static void stats_realloc(const size_t bytes)
+{
+    STATS_ADD(GOPTFOO_STATS_LIST, reallocs, 1);
+    STATS_ADD(GOPTFOO_STATS_LIST, realloc_bytes, bytes);
+    GF_PROBE1(realloc, bytes);
+}
+
+#define STATS_START(kind, t) const uint64_t t = stats_start(kind)
+#define STATS_END(kind, t, bytes, values) stats_end(kind, t, bytes, values)
+#define STATS_REALLOC(bytes) stats_realloc(bytes)
+#define STATS_BYTES(n) STATS_ADD(GOPTFOO_STATS_LIST, bytes, n)
+#else
+#define STATS_START(kind, t)
+#define STATS_END(kind, t, bytes, values)
+#define STATS_REALLOC(bytes)
+#define STATS_BYTES(n)
+#endif
+
+int goptfoo_stats(struct goptfoo_counters counters_out[GOPTFOO_STATS_KINDS])
+{
+#ifdef GOPTFOO_STATS
+    int kind;
+
+    for (kind = 0; kind < GOPTFOO_STATS_KINDS; kind++) {
+        counters_out[kind].calls = STATS_GET(kind, calls);
+        counters_out[kind].bytes = STATS_GET(kind, bytes);
+        counters_out[kind].values = STATS_GET(kind, values);
+        counters_out[kind].reallocs = STATS_GET(kind, reallocs);
+        counters_out[kind].realloc_bytes = STATS_GET(kind, realloc_bytes);
+        counters_out[kind].cycles = STATS_GET(kind, cycles);
+    }
+    return 0;
+#else
+    memset(counters_out, 0,
+           GOPTFOO_STATS_KINDS * sizeof(struct goptfoo_counters));
+    return -1;
+#endif
+}
+
+/* allocation ********************************************************* */
+
+/* list items come from the allocator of the context, or realloc(3) and
+ * free(3), and every change in their size goes through items_resize so
+ * that the process-wide budget can be charged for growth before the
+ * memory is asked for. the budget and the default allocator are the only
+ * global state that parsing touches, and are updated atomically */
+
+#ifdef __GNUC__
+#define gf_load(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define gf_store(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define gf_cas(x, old, new)                                             \
+    __atomic_compare_exchange_n(&(x), &(old), (new), 1,                 \
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#else
+#define gf_load(x) (x)
+#define gf_store(x, v) ((x) = (v))
+#define gf_cas(x, old, new)                                             \
+    ((x) == (old) ? ((x) = (new), 1) : ((old) = (x), 0))
+#endif
+
+static const struct goptfoo_alloc *alloc_default;
+static size_t budget_max, budget_used;
+
+/* the count is only kept while there is a cap. without one lists grow
+ * by doubling and are given back by numitems, if at all, so a count
+ * kept then would only ever climb */
+
+/* take bytes from the budget, or -1 should that go over it */
+static int budget_take(const size_t bytes)
+{
+    size_t max = gf_load(budget_max), used = gf_load(budget_used);
+
+    if (!max)
+        return 0;
+    do {
+        if (bytes > max || used > max - bytes)
+            return -1;
+    } while (!gf_cas(budget_used, used, used + bytes));
+    return 0;
+}
+
+static void budget_give(const size_t bytes)
+{
+    size_t used = gf_load(budget_used);
+
+    if (!gf_load(budget_max))
+        return;
+    while (!gf_cas(budget_used, used, used > bytes ? used - bytes : 0)) ;
+}
+
+/* resize the items at *items from old to size bytes, GOPTFOO_OK or else
+ * GOPTFOO_EBUDGET or GOPTFOO_ENOMEM with the items left as they were */
+static int items_resize(const struct goptfoo_alloc *a, void **items,
+                        const size_t old, const size_t size)
+{
+    void *p;
+
+    if (size > old && budget_take(size - old) < 0)
+        return GOPTFOO_EBUDGET;
+    if ((p = a ? a->realloc(*items, size, a->data)
+         : realloc(*items, size)) == NULL) {
+        if (size > old)
+            budget_give(size - old);
+        return GOPTFOO_ENOMEM;
+    }
+    if (size < old)
+        budget_give(old - size);
+    *items = p;
+    return GOPTFOO_OK;
+}
+
+static void items_free(const struct goptfoo_alloc *a, void *items,
+                       const size_t bytes)
+{
+    if (!items)
+        return;
+    budget_give(bytes);
+    if (a)
+        a->free(items, a->data);
+    else
+        free(items);
+}
+
+/* everything else the library allocates, the sets, matrices, key=value
+ * lists, option indexes, and the buffers that input is read through, is
+ * made of many smaller pieces, and so comes from realloc(3) rather than
+ * the allocator of the context; it is still counted against the budget.
+ * mem_resize leaves the GOPTFOO_E* code in *ret and returns NULL should
+ * it fail, with p left as it was */
+static void *mem_resize(void *p, const size_t old, const size_t size,
+                        int *ret)
+{
+    *ret = items_resize(NULL, &p, old, size);
+    return *ret == GOPTFOO_OK ? p : NULL;
+}
+
+static void *mem_zero(const size_t n, const size_t size, int *ret)
+{
+    void *p;
+
+    if (size && n > SIZE_MAX / size) {
+        errno = ENOMEM;
+        *ret = GOPTFOO_ENOMEM;
+        return NULL;
+    }
+    if ((p = mem_resize(NULL, 0, n * size, ret)) != NULL)
+        memset(p, 0, n * size);
+    return p;
+}
+
+static void mem_free(void *p, const size_t bytes)
+{
+    items_free(NULL, p, bytes);
+}
+
+/* the mmap allocator gives each list its own anonymous mapping, with
+ * the length of the mapping in a header in front of the items. growth
+ * is by mremap(2) where the system has it, which moves the pages rather
+ * than copying them, and mappings of GOPTFOO_HUGE_PAGE or more are first
+ * placed at a multiple of that and given to madvise(2) for transparent
+ * huge pages, so that a large list takes fewer TLB entries and page
+ * faults */
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#define GOPTFOO_MAP_HEAD 64     /* keeps the items aligned for vectors */
+
+static size_t map_page(void)
+{
+    static size_t page;
+    long n;
+
+    if (page == 0)
+        page = (n = sysconf(_SC_PAGESIZE)) > 0 ? (size_t) n : 4096;
+    return page;
+}
+
+static void map_advise(char *map, const size_t len)
+{
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+    if (len >= GOPTFOO_HUGE_PAGE)
+        madvise(map, len, MADV_HUGEPAGE);
+#else
+    (void) map;
+    (void) len;
+#endif
+}
+
+static char *map_new(const size_t len)
+{
+    size_t extra = len >= GOPTFOO_HUGE_PAGE ? GOPTFOO_HUGE_PAGE : 0, head;
+    char *map;
+
+    if ((map = mmap(NULL, len + extra, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+        return NULL;
+    if (extra) {
+        head = (GOPTFOO_HUGE_PAGE - (uintptr_t) map % GOPTFOO_HUGE_PAGE)
+            % GOPTFOO_HUGE_PAGE;
+        if (head > 0)
+            munmap(map, head);
+        if (extra - head > 0)
+            munmap(map + head + len, extra - head);
+        map += head;
+    }
+    map_advise(map, len);
+    return map;
+}
+
+static void *map_realloc(void *ptr, size_t size, void *data)
+{
+    const size_t page = map_page();
+    size_t len, old = 0;
+    char *map = NULL, *p;
+
+    (void) data;
+    if (size > SIZE_MAX - GOPTFOO_MAP_HEAD - GOPTFOO_HUGE_PAGE - page) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    len = (size + GOPTFOO_MAP_HEAD + page - 1) / page * page;
+    if (ptr) {
+        map = (char *) ptr - GOPTFOO_MAP_HEAD;
+        memcpy(&old, map, sizeof(old));
+        if (len == old)
+            return ptr;
+    }
+    if (!map) {
+        p = map_new(len);
+    } else {
+#ifdef HAVE_MREMAP
+        if ((p = mremap(map, old, len, MREMAP_MAYMOVE)) == MAP_FAILED)
+            p = NULL;
+        else
+            map_advise(p, len);
+#else
+        if (len < old) {
+            munmap(map + len, old - len);
+            p = map;
+        } else if ((p = map_new(len)) != NULL) {
+            memcpy(p, map, old);
+            munmap(map, old);
+        }
+#endif
+    }
+    if (p == NULL)
+        return NULL;
+    memcpy(p, &len, sizeof(len));
+    return p + GOPTFOO_MAP_HEAD;
+}
+
+static void map_free(void *ptr, void *data)
+{
+    char *map;
+    size_t len;
+
+    (void) data;
+    if (!ptr)
+        return;
+    map = (char *) ptr - GOPTFOO_MAP_HEAD;
+    memcpy(&len, map, sizeof(len));
+    munmap(map, len);
+}
+
+const struct goptfoo_alloc goptfoo_mmap_alloc = {
+    map_realloc, map_free, NULL
+};
+
+const struct goptfoo_alloc *goptfoo_set_alloc(const struct goptfoo_alloc
+                                              *alloc)
+{
+    const struct goptfoo_alloc *prev = gf_load(alloc_default);
+
+    gf_store(alloc_default, alloc);
+    return prev;
+}
+
+void goptfoo_free(const struct goptfoo_alloc *alloc, void *items,
+                  const size_t bytes)
+{
+    items_free(alloc, items, bytes);
+}
+
+size_t goptfoo_budget(const size_t bytes)
+{
+    size_t prev = gf_load(budget_max);
+
+    gf_store(budget_max, bytes);
+    if (!bytes)
+        gf_store(budget_used, 0);
+    return prev;
+}
+
+size_t goptfoo_budget_used(void)
+{
+    return gf_load(budget_used);
+}
+
+/* goptfoo_parse_* **************************************************** */
+
+/* the parse functions do not exit; instead they return a GOPTFOO_E*
+ * code and fill in the caller's context with where things went wrong.
+ * the only global state they touch is the memory budget, which is kept
+ * atomically, and the default allocator, which goptfoo_ctx_init reads,
+ * so different threads may parse at the same time given their own
+ * contexts */
+
+static const char *const errstrs[] = {
+    [GOPTFOO_OK] = "no error",
+    [GOPTFOO_ENOTSET] = "value not set",
+    [GOPTFOO_ENEGATIVE] = "value must be positive",
+    [GOPTFOO_ECHAR] = "non-digit non-space character",
+    [GOPTFOO_EPARSE] = "could not parse value",
+    [GOPTFOO_ERANGE] = "value out of range for type",
+    [GOPTFOO_EMIN] = "value is below min",
+    [GOPTFOO_EMAX] = "value is above max",
+    [GOPTFOO_ETOOFEW] = "too few values",
+    [GOPTFOO_ETOOMANY] = "too many values",
+    [GOPTFOO_ELISTMAX] = "list_max too large for type",
+    [GOPTFOO_EPREFILL] = "too many items in list already",
+    [GOPTFOO_ENOMEM] = "could not allocate memory",
+    [GOPTFOO_EFILE] = "could not read @file",
+    [GOPTFOO_ESTOPPED] = "stopped by callback",
+    [GOPTFOO_EFORMAT] = "bad @bin: format or size",
+    [GOPTFOO_EOPTION] = "unknown option",
+    [GOPTFOO_EOPTARG] = "option value missing or not wanted",
+    [GOPTFOO_ETABLE] = "bad option table entry",
+    [GOPTFOO_ESHAPE] = "ragged or empty matrix row",
+    [GOPTFOO_EKEY] = "entry is not key=value",
+    [GOPTFOO_EDUPKEY] = "duplicate key",
+    [GOPTFOO_EBUDGET] = "over the memory budget",
+};
+
+void goptfoo_ctx_init(struct goptfoo_ctx *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->alloc = gf_load(alloc_default);
+}
+
+const char *goptfoo_strerror(int code)
+{
+    if (code < 0 || code >= (int) (sizeof(errstrs) / sizeof(errstrs[0]))
+        || !errstrs[code])
+        return "unknown error";
+    return errstrs[code];
+}
+
+/* record an error for the token at tok (which may be NULL) within the
+ * input that starts at base */
+static int fail(struct goptfoo_ctx *ctx, int code, const char *base,
+                const char *tok, const char *end, size_t index)
+{
+    size_t len = 0;
+
+    ctx->code = code;
+    ctx->index = index;
+    ctx->offset = tok ? (size_t) (tok - base) : 0;
+    if (tok) {
+        while (tok + len < end && len < sizeof(ctx->token) - 1
+               && !gf_isspace(tok[len]))
+            len++;
+        memcpy(ctx->token, tok, len);
+    }
+    ctx->token[len] = '\0';
+    return code;
+}
+
+static int fail_nomem(struct goptfoo_ctx *ctx, size_t count)
+{
+    fail(ctx, GOPTFOO_ENOMEM, NULL, NULL, NULL, count);
+    ctx->oserr = errno;
+    return GOPTFOO_ENOMEM;
+}
+
+/* for what items_resize returned */
+static int fail_alloc(struct goptfoo_ctx *ctx, int code, size_t count)
+{
+    if (code == GOPTFOO_ENOMEM)
+        return fail_nomem(ctx, count);
+    return fail(ctx, code, NULL, NULL, NULL, count);
+}
+
+int goptfoo_parse_d(struct goptfoo_ctx *ctx, const char *arg,
+                    const double min, const double max, double *value)
+{
+    const char *ep, *p, *end;
+    double val;
+    int ret;
+
+    ctx->code = GOPTFOO_OK;
+    if (!arg || *arg == '\0')
+        return fail(ctx, GOPTFOO_ENOTSET, NULL, NULL, NULL, 0);
+
+    for (p = arg; gf_isspace(*p); p++) ;
+    end = p + strlen(p);
+    ret = scan_d(p, end, &ep, &val);
+    if (ret == SCAN_NOMEM)
+        return fail_nomem(ctx, 0);
+    if (ret == SCAN_NONE || ep != end)
+        return fail(ctx, GOPTFOO_EPARSE, arg, p, end, 0);
+    if (ret == SCAN_RANGE)
+        return fail(ctx, GOPTFOO_ERANGE, arg, p, end, 0);
+    if (isfinite(min) && val < min)
+        return fail(ctx, GOPTFOO_EMIN, arg, p, end, 0);
+    if (isfinite(max) && val > max)
+        return fail(ctx, GOPTFOO_EMAX, arg, p, end, 0);
+
+    *value = val;
+    return GOPTFOO_OK;
+}
+
+int goptfoo_parse_ll(struct goptfoo_ctx *ctx, const char *arg,
+                     const long long min, const long long max,
+                     long long *value)
+{
+    const char *ep, *p, *end;
+    long long val;
+    int ret;
+
+    ctx->code = GOPTFOO_OK;
+    if (!arg || *arg == '\0')
+        return fail(ctx, GOPTFOO_ENOTSET, NULL, NULL, NULL, 0);
+
+    for (p = arg; gf_isspace(*p); p++) ;
+    end = p + strlen(p);
+    ret = scan_ll(p, end, &ep, &val, flags_radix(ctx->flags));
+    if (ret == SCAN_NONE || ep != end)
+        return fail(ctx, GOPTFOO_EPARSE, arg, p, end, 0);
+    if (ret == SCAN_RANGE)
+        return fail(ctx, GOPTFOO_ERANGE, arg, p, end, 0);
+    if (min != LLONG_MIN && val < min)
+        return fail(ctx, GOPTFOO_EMIN, arg, p, end, 0);
+    if (max != LLONG_MAX && val > max)
+        return fail(ctx, GOPTFOO_EMAX, arg, p, end, 0);
+
+    *value = val;
+    return GOPTFOO_OK;
+}
+
+int goptfoo_parse_ul(struct goptfoo_ctx *ctx, const char *arg,
+                     const unsigned long min, const unsigned long max,
+                     unsigned long *value)
+{
+    const char *ep, *p, *end;
+    unsigned long val;
+    int radix, ret;
+
+    ctx->code = GOPTFOO_OK;
+    if (!arg || *arg == '\0')
+        return fail(ctx, GOPTFOO_ENOTSET, NULL, NULL, NULL, 0);
+
+    for (p = arg; gf_isspace(*p); p++) ;
+    end = p + strlen(p);
+    radix = flags_radix(ctx->flags);
+    if (*p != '+' && !gf_isradix(*p, radix))
+        return fail(ctx, GOPTFOO_ENEGATIVE, arg, p, end, 0);
+    ret = scan_ul(p, end, &ep, &val, radix);
+    if (ret == SCAN_NONE || ep != end)
+        return fail(ctx, GOPTFOO_EPARSE, arg, p, end, 0);
+    if (ret == SCAN_RANGE)
+        return fail(ctx, GOPTFOO_ERANGE, arg, p, end, 0);
+    if (min != 0 && val < min)
+        return fail(ctx, GOPTFOO_EMIN, arg, p, end, 0);
+    if (max != ULONG_MAX && val > max)
+        return fail(ctx, GOPTFOO_EMAX, arg, p, end, 0);
+
+    *value = val;
+    return GOPTFOO_OK;
+}
+
+/* there are three variables related to the number of items in the list
+ * functions; numi is sent back to the user via *numitems, and should be
+ * the number of items; list_max sets a user-specified (or at most the
+ * data type allows to avoid size_t overflows) high water mark, while
+ * the alloitems variable is for how many items have been allocated,
+ * which will usually be above the number of items and hopefully not
+ * beyond list_max */
+
+enum { LIST_D, LIST_LL, LIST_UL, LIST_F, LIST_I32, LIST_I16, LIST_U32,
+    LIST_U8
+};
+
+struct list {
+    int type;
+    size_t size;
+    union goptfoo_value min, max;
+    void **items;
+    size_t numi;
+    size_t alloitems;
+    size_t list_max;
+    int fixed;                  /* caller-supplied buffer, never realloc */
+    int each;                   /* values go to fn instead of items */
+    union {
+        int (*d)(double, void *);
+        int (*ll)(long long, void *);
+        int (*ul)(unsigned long, void *);
+    } fn;
+    void *data;
+};
+
+static int list_setup(struct goptfoo_ctx *ctx, struct list *l)
+{
+    ctx->code = GOPTFOO_OK;
+
+    /* caller-supplied buffers set list_max and alloitems to their size */
+    if (!l->fixed) {
+        if (l->list_max > SIZE_MAX / l->size)
+            return fail(ctx, GOPTFOO_ELISTMAX, NULL, NULL, NULL, 0);
+        else if (l->list_max == 0)
+            l->list_max = SIZE_MAX / l->size;
+    }
+    if (l->numi > l->list_max)
+        return fail(ctx, GOPTFOO_EPREFILL, NULL, NULL, NULL, 0);
+    return GOPTFOO_OK;
+}
+
+/* (re)allocate the items to hold want items in total, at least one so
+ * that *items is not left NULL for an empty list */
+static int list_reserve(struct goptfoo_ctx *ctx, struct list *l,
+                        size_t want)
+{
+    int ret;
+
+    if (l->fixed)
+        return GOPTFOO_OK;
+    if (want > l->list_max)
+        want = l->list_max;
+    if (want == 0)
+        want = 1;
+    /* really want reallocarray(3) but that's not portable enough yet */
+    if ((ret = items_resize(ctx->alloc, l->items, l->alloitems * l->size,
+                            want * l->size)) != GOPTFOO_OK)
+        return fail_alloc(ctx, ret, want);
+    STATS_REALLOC(want * l->size);
+    l->alloitems = want;
+    return GOPTFOO_OK;
+}
+
+/* count the whitespace separated words in [p, end), eight bytes at a
+ * time where possible. this is a lower bound on the number of values as
+ * "1-2" is two values for the integer types */
+#ifdef GOPTFOO_SWAR
+/* 0x80 in each byte that is whitespace; each test stays within its own
+ * byte so that there are no carries between them */
+static inline uint64_t swar_spaces8(uint64_t v)
+{
+    const uint64_t h = 0x8080808080808080ULL, l7 = 0x7F7F7F7F7F7F7F7FULL;
+    uint64_t lo = v & l7, x = v ^ 0x2020202020202020ULL;
+    uint64_t sp = ~(((x & l7) + l7) | x) & h;
+    uint64_t ge9 = (lo + 0x7777777777777777ULL) & h;
+    uint64_t ge14 = (lo + 0x7272727272727272ULL) & h;
+    return sp | (ge9 & ~ge14 & ~v & h);
+}
+#endif
+
+static size_t count_words(const char *p, const char *end)
+{
+    size_t n = 0;
+    int prev = 1;
+#ifdef GOPTFOO_SWAR
+    uint64_t chunk, ws, carry = 0x80;
+    while (end - p >= 8) {
+        memcpy(&chunk, p, sizeof(chunk));
+        ws = swar_spaces8(chunk);
+        n += (size_t) __builtin_popcountll(~ws & ((ws << 8) | carry) &
+                                           0x8080808080808080ULL);
+        carry = ws >> 56;
+        p += 8;
+    }
+    prev = carry != 0;
+#endif
+    for (; p < end; p++) {
+        int sp = gf_isspace(*p);
+        n += prev && !sp;
+        prev = sp;
+    }
+    return n;
+}
+
+/* lists are sized exactly with GOPTFOO_EXACT, or under a budget */
+static int list_exact(const struct goptfoo_ctx *ctx)
+{
+    return (ctx->flags & GOPTFOO_EXACT) || gf_load(budget_max) != 0;
+}
+
+/* the initial allocation for the values in [p, end), or for a stream of
+ * unknown size when p is NULL. with GOPTFOO_EXACT a quick pre-pass
+ * counts the words so that (usually) only one allocation is made, and
+ * an input too large for the budget fails before any is */
+static int list_reserve_for(struct goptfoo_ctx *ctx, struct list *l,
+                            const char *p, const char *end)
+{
+    size_t want, words;
+
+    if (l->fixed)
+        return GOPTFOO_OK;
+    if (p && list_exact(ctx)) {
+        words = count_words(p, end);
+        if (words > l->list_max - l->numi)
+            return list_reserve(ctx, l, l->list_max);
+        return list_reserve(ctx, l, l->numi + words);
+    }
+
+    want = 8;                   /* arbitrary starting point */
+    if (l->numi > 0)
+        want = l->numi << 1;
+    /* resize items to allocate down, or up if the provided list_max is
+     * "close" to the starting number of items to allocate */
+    if (want > l->list_max || (want << 2) > l->list_max)
+        want = l->list_max;
+    return list_reserve(ctx, l, want);
+}
+
+/* make room for one more item, or fail if list_max has been reached */
+static inline int list_grow(struct goptfoo_ctx *ctx, void **items,
+                            const size_t size, size_t numi,
+                            size_t * alloitems, size_t list_max)
+{
+    size_t want;
+    int ret;
+
+    if (numi < *alloitems)
+        return GOPTFOO_OK;
+    if (numi >= list_max)
+        return GOPTFOO_ETOOMANY;
+    want = *alloitems << 1;
+    if (want > list_max || want < *alloitems)
+        want = list_max;
+    if ((ret = items_resize(ctx->alloc, items, *alloitems * size,
+                            want * size)) != GOPTFOO_OK)
+        return fail_alloc(ctx, ret, want);
+    STATS_REALLOC(want * size);
+    *alloitems = want;
+    return GOPTFOO_OK;
+}
+
+/* bounds checks ****************************************************** */
+
+/* the values of a list are checked against min and max a block at a
+ * time after they have been parsed, rather than one by one as they are,
+ * with loops of a constant stride that the compiler vectorizes. where
+ * it can, the loops are built both for AVX2 and for the baseline (SSE2
+ * on x86-64), and the one to use picked at runtime; elsewhere they are
+ * whatever the compiler makes of them. only should a block fail is the
+ * first value at fault looked for */
+
+#if defined(HAVE_TARGET_CLONES) && defined(__GNUC__)
+#define gf_clones __attribute__((target_clones("avx2", "default")))
+#else
+#define gf_clones
+#endif
+
+#define GOPTFOO_STRIDE 64
+
+/* bounds that span the whole type need no checks */
+#define BOUNDS(name, T, tmin, tmax)                                     \
+static gf_clones int name(const T *v, const size_t n, const T min,      \
+                          const T max)                                  \
+{                                                                       \
+    size_t i = 0, j;                                                    \
+    int bad = 0;                                                        \
+    if (min <= (tmin) && max >= (tmax))                                 \
+        return 1;                                                       \
+    for (; n - i >= GOPTFOO_STRIDE; i += GOPTFOO_STRIDE)                \
+        for (j = 0; j < GOPTFOO_STRIDE; j++)                            \
+            bad |= (v[i + j] < min) | (v[i + j] > max);                 \
+    for (; i < n; i++)                                                  \
+        bad |= (v[i] < min) | (v[i] > max);                             \
+    return !bad;                                                        \
+}
+
+BOUNDS(bounds_ll, long long, LLONG_MIN, LLONG_MAX)
+BOUNDS(bounds_i32, int32_t, INT32_MIN, INT32_MAX)
+BOUNDS(bounds_i16, int16_t, INT16_MIN, INT16_MAX)
+BOUNDS(bounds_ul, unsigned long, 0, ULONG_MAX)
+BOUNDS(bounds_u32, uint32_t, 0, UINT32_MAX)
+BOUNDS(bounds_u8, uint8_t, 0, UINT8_MAX)
+
+/* a min or max that is not finite is no limit. NaN is let through as
+ * parsing has always done, unless nan_ok is zero */
+#define BOUNDS_FP(name, T)                                              \
+static gf_clones int name(const T *v, const size_t n, double min,       \
+                          double max, const int nan_ok)                 \
+{                                                                       \
+    size_t i = 0, j;                                                    \
+    int bad = 0, nan = 0;                                               \
+    if (!isfinite(min))                                                 \
+        min = -INFINITY;                                                \
+    if (!isfinite(max))                                                 \
+        max = INFINITY;                                                 \
+    for (; n - i >= GOPTFOO_STRIDE; i += GOPTFOO_STRIDE)                \
+        for (j = 0; j < GOPTFOO_STRIDE; j++) {                          \
+            bad |= (v[i + j] < min) | (v[i + j] > max);                 \
+            nan |= v[i + j] != v[i + j];                                \
+        }                                                               \
+    for (; i < n; i++) {                                                \
+        bad |= (v[i] < min) | (v[i] > max);                             \
+        nan |= v[i] != v[i];                                            \
+    }                                                                   \
+    return !bad && (nan_ok || !nan);                                    \
+}
+
+BOUNDS_FP(bounds_d, double)
+BOUNDS_FP(bounds_f, float)
+
+static int list_bounds(const struct list *l, const void *p, const size_t n,
+                       const int nan_ok)
+{
+    switch (l->type) {
+    case LIST_D:
+        return bounds_d(p, n, l->min.d, l->max.d, nan_ok);
+    case LIST_F:
+        return bounds_f(p, n, l->min.d, l->max.d, nan_ok);
+    case LIST_LL:
+        return bounds_ll(p, n, l->min.ll, l->max.ll);
+    case LIST_I32:
+        return bounds_i32(p, n, (int32_t) l->min.ll, (int32_t) l->max.ll);
+    case LIST_I16:
+        return bounds_i16(p, n, (int16_t) l->min.ll, (int16_t) l->max.ll);
+    case LIST_UL:
+        return bounds_ul(p, n, l->min.ul, l->max.ul);
+    case LIST_U32:
+        return bounds_u32(p, n, (uint32_t) l->min.ul, (uint32_t) l->max.ul);
+    default:
+        return bounds_u8(p, n, (uint8_t) l->min.ul, (uint8_t) l->max.ul);
+    }
+}
+
+/* value i at p, as the wide type */
+static void list_value(const struct list *l, const void *p, const size_t i,
+                       union goptfoo_value *value)
+{
+    switch (l->type) {
+    case LIST_D:
+        value->d = ((const double *) p)[i];
+        break;
+    case LIST_F:
+        value->d = ((const float *) p)[i];
+        break;
+    case LIST_LL:
+        value->ll = ((const long long *) p)[i];
+        break;
+    case LIST_I32:
+        value->ll = ((const int32_t *) p)[i];
+        break;
+    case LIST_I16:
+        value->ll = ((const int16_t *) p)[i];
+        break;
+    case LIST_UL:
+        value->ul = ((const unsigned long *) p)[i];
+        break;
+    case LIST_U32:
+        value->ul = ((const uint32_t *) p)[i];
+        break;
+    default:
+        value->ul = ((const uint8_t *) p)[i];
+        break;
+    }
+}
+
+/* the index of the first of the n values at p that is out of bounds,
+ * with the error in code, or n if all are fine */
+static size_t list_check(const struct list *l, const void *p,
+                         const size_t n, const int nan_ok, int *code)
+{
+    union goptfoo_value v;
+    size_t i;
+
+    if (n == 0 || list_bounds(l, p, n, nan_ok))
+        return n;
+    for (i = 0; i < n; i++) {
+        list_value(l, p, i, &v);
+        *code = GOPTFOO_OK;
+        switch (l->type) {
+        case LIST_D:
+        case LIST_F:
+            if (isnan(v.d))
+                *code = nan_ok ? GOPTFOO_OK : GOPTFOO_EPARSE;
+            else if (isfinite(l->min.d) && v.d < l->min.d)
+                *code = GOPTFOO_EMIN;
+            else if (isfinite(l->max.d) && v.d > l->max.d)
+                *code = GOPTFOO_EMAX;
+            break;
+        case LIST_LL:
+        case LIST_I32:
+        case LIST_I16:
+            if (v.ll < l->min.ll)
+                *code = GOPTFOO_EMIN;
+            else if (v.ll > l->max.ll)
+                *code = GOPTFOO_EMAX;
+            break;
+        default:
+            if (v.ul < l->min.ul)
+                *code = GOPTFOO_EMIN;
+            else if (v.ul > l->max.ul)
+                *code = GOPTFOO_EMAX;
+            break;
+        }
+        if (*code != GOPTFOO_OK)
+            return i;
+    }
+    return n;
+}
+
+/* iterator *********************************************************** */
+
+/* the iterator yields the values in [p, end) one at a time, and is the
+ * one loop that all the list functions are built on */
+
+static void iter_setup(struct goptfoo_iter *it, struct goptfoo_ctx *ctx,
+                       int type, const char *base, const char *p,
+                       const char *end, size_t index)
+{
+    it->ctx = ctx;
+    it->flags = ctx->flags;
+    it->type = type;
+    it->base = base;
+    it->p = it->tok = p;
+    it->end = end;
+    it->index = index;
+    it->range.count = it->ri = 0;
+}
+
+static inline int iter_fail(struct goptfoo_iter *it, int code)
+{
+    fail(it->ctx, code, it->base, it->tok, it->end, it->index);
+    return -1;
+}
+
+static gf_inline int iter_check(struct goptfoo_iter *it, const int type,
+                                const union goptfoo_value *value)
+{
+    switch (type) {
+    case LIST_D:
+        if (isfinite(it->min.d) && value->d < it->min.d)
+            return iter_fail(it, GOPTFOO_EMIN);
+        if (isfinite(it->max.d) && value->d > it->max.d)
+            return iter_fail(it, GOPTFOO_EMAX);
+        break;
+    case LIST_LL:
+        if (it->min.ll != LLONG_MIN && value->ll < it->min.ll)
+            return iter_fail(it, GOPTFOO_EMIN);
+        if (it->max.ll != LLONG_MAX && value->ll > it->max.ll)
+            return iter_fail(it, GOPTFOO_EMAX);
+        break;
+    default:
+        if (it->min.ul != 0 && value->ul < it->min.ul)
+            return iter_fail(it, GOPTFOO_EMIN);
+        if (it->max.ul != ULONG_MAX && value->ul > it->max.ul)
+            return iter_fail(it, GOPTFOO_EMAX);
+        break;
+    }
+    return 0;
+}
+
+/* value i of a range. doubles are interpolated between the ends so that
+ * those come out exactly, and kept within them should rounding stray */
+static gf_inline void range_value(const struct goptfoo_range *r, size_t i,
+                                  union goptfoo_value *value)
+{
+    unsigned long long d;
+    double t, v;
+
+    switch (r->type) {
+    case LIST_D:
+        if (i + 1 >= r->count) {
+            value->d = r->last.d;
+            break;
+        }
+        t = (double) i / (double) (r->count - 1);
+        v = (1 - t) * r->first.d + t * r->last.d;
+        if (r->down ? v > r->first.d : v < r->first.d)
+            v = r->first.d;
+        if (r->down ? v < r->last.d : v > r->last.d)
+            v = r->last.d;
+        value->d = v;
+        break;
+    case LIST_LL:
+        d = (unsigned long long) i * r->step;
+        value->ll = (long long) (r->down
+                                 ? (unsigned long long) r->first.ll - d
+                                 : (unsigned long long) r->first.ll + d);
+        break;
+    default:
+        d = (unsigned long long) i * r->step;
+        value->ul = r->down ? r->first.ul - (unsigned long) d
+            : r->first.ul + (unsigned long) d;
+        break;
+    }
+}
+
+/* with GOPTFOO_RANGES a value followed by '-' (':' for doubles) starts a
+ * range, "a-b" or "a-b:step" for the integer types and "a:b:n" for n
+ * doubles from a to b. p is at the separator, and the first value has
+ * already been scanned. only the ends are checked against min and max,
+ * as the values in between can be no further out */
+static int range_scan(struct goptfoo_iter *it, const int type,
+                      const int radix, const union goptfoo_value *first,
+                      const char *p)
+{
+    struct goptfoo_range *r = &it->range;
+    const char *end = it->end, *ep;
+    union goptfoo_value last;
+    unsigned long long diff;
+    unsigned long n = 1;
+    int ret;
+
+    p++;
+    switch (type) {
+    case LIST_D:
+        if (p == end
+            || (*p != '+' && *p != '.' && *p != '-' && !gf_isdigit(*p)))
+            return iter_fail(it, GOPTFOO_EPARSE);
+        ret = scan_d(p, end, &ep, &last.d);
+        if (ret == SCAN_NOMEM) {
+            fail_nomem(it->ctx, 0);
+            return -1;
+        }
+        break;
+    case LIST_LL:
+        if (p == end || (*p != '-' && !gf_isradix(*p, radix)))
+            return iter_fail(it, GOPTFOO_EPARSE);
+        ret = scan_ll(p, end, &ep, &last.ll, radix);
+        break;
+    default:
+        if (p == end || !gf_isradix(*p, radix))
+            return iter_fail(it, GOPTFOO_EPARSE);
+        ret = scan_ul(p, end, &ep, &last.ul, radix);
+        break;
+    }
+    if (ret == SCAN_NONE)
+        return iter_fail(it, GOPTFOO_EPARSE);
+    if (ret == SCAN_RANGE)
+        return iter_fail(it, GOPTFOO_ERANGE);
+
+    if (ep < end && *ep == ':') {
+        p = ep + 1;
+        if (p == end || !gf_isradix(*p, radix))
+            return iter_fail(it, GOPTFOO_EPARSE);
+        ret = scan_ul(p, end, &ep, &n, radix);
+        if (ret == SCAN_NONE || n == 0)
+            return iter_fail(it, GOPTFOO_EPARSE);
+        if (ret == SCAN_RANGE)
+            return iter_fail(it, GOPTFOO_ERANGE);
+    } else if (type == LIST_D) {
+        return iter_fail(it, GOPTFOO_EPARSE);
+    }
+
+    r->type = type;
+    r->first = *first;
+    r->step = n;
+    switch (type) {
+    case LIST_D:
+        r->down = last.d < first->d;
+        r->last = n == 1 ? *first : last;
+        r->count = n;
+        break;
+    case LIST_LL:
+        r->down = last.ll < first->ll;
+        diff = r->down
+            ? (unsigned long long) first->ll - (unsigned long long) last.ll
+            : (unsigned long long) last.ll - (unsigned long long) first->ll;
+        goto count;
+    default:
+        r->down = last.ul < first->ul;
+        diff = r->down ? first->ul - last.ul : last.ul - first->ul;
+      count:
+        if (diff / n >= SIZE_MAX)
+            return iter_fail(it, GOPTFOO_ERANGE);
+        r->count = (size_t) (diff / n) + 1;
+        range_value(r, r->count - 1, &r->last);
+        break;
+    }
+
+    if (iter_check(it, type, r->down ? &r->last : &r->first) < 0
+        || iter_check(it, type, r->down ? &r->first : &r->last) < 0)
+        return -1;
+    it->p = ep;
+    it->index += r->count;
+    return 2;
+}
+
+/* 1 and the next value, 2 for a range now in it->range, 0 at the end of
+ * the input, or -1 on error. the type is passed separately so that
+ * where it is a constant the switches fold away, as with the radix of
+ * the integers. without check, values are not held to min and max
+ * (though the ends of ranges still are) as the caller will check them
+ * in bulk */
+static gf_inline int iter_type_step(struct goptfoo_iter *it,
+                                    const int type, const int radix,
+                                    union goptfoo_value *value,
+                                    const int check)
+{
+    const char *p = it->p, *end = it->end, *ep;
+    int ret;
+
+    while (p < end && gf_isspace(*p))
+        p++;
+    it->p = it->tok = p;
+    if (p == end)
+        return 0;
+
+    switch (type) {
+    case LIST_D:
+        /* strtod(3) accepts ".95" as well as "0.95" so support that */
+        if (*p != '+' && *p != '.' && *p != '-' && !gf_isdigit(*p))
+            return iter_fail(it, GOPTFOO_ECHAR);
+        ret = scan_d(p, end, &ep, &value->d);
+        if (ret == SCAN_NOMEM) {
+            fail_nomem(it->ctx, 0);
+            return -1;
+        }
+        break;
+    case LIST_LL:
+        if (*p != '+' && *p != '-' && !gf_isradix(*p, radix))
+            return iter_fail(it, GOPTFOO_ECHAR);
+        ret = scan_ll(p, end, &ep, &value->ll, radix);
+        break;
+    default:
+        if (*p != '+' && !gf_isradix(*p, radix))
+            return iter_fail(it, GOPTFOO_ECHAR);
+        ret = scan_ul(p, end, &ep, &value->ul, radix);
+        break;
+    }
+
+    /* no movement on pointer. can be caused by " + " or such in the
+     * input. cannot do usual '\0' check as more numbers may follow,
+     * though do need some means to detect such cases */
+    if (ret == SCAN_NONE)
+        return iter_fail(it, GOPTFOO_EPARSE);
+    if (ret == SCAN_RANGE)
+        return iter_fail(it, GOPTFOO_ERANGE);
+
+    if ((it->flags & GOPTFOO_RANGES) && ep < end
+        && *ep == (type == LIST_D ? ':' : '-'))
+        return range_scan(it, type, radix, value, ep);
+
+    if (check && iter_check(it, type, value) < 0)
+        return -1;
+    it->p = ep;
+    it->index++;
+    return 1;
+}
+
+static int iter_step(struct goptfoo_iter *it, union goptfoo_value *value)
+{
+    return iter_type_step(it, it->type, flags_radix(it->flags), value, 1);
+}
+
+/* hand a value to the callback of a goptfoo_each_* list */
+static int list_call(struct list *l, union goptfoo_value *value)
+{
+    switch (l->type) {
+    case LIST_D:
+        return l->fn.d(value->d, l->data);
+    case LIST_LL:
+        return l->fn.ll(value->ll, l->data);
+    default:
+        return l->fn.ul(value->ul, l->data);
+    }
+}
+
+/* append all the values of the range just scanned, having first made
+ * sure that they fit */
+static int list_expand(struct goptfoo_ctx *ctx, struct list *l,
+                       const int type, const struct goptfoo_iter *it)
+{
+    const struct goptfoo_range *r = &it->range;
+    union goptfoo_value value;
+    unsigned long long x, step;
+    size_t i, want;
+    int ret;
+
+    if (l->each) {
+        if (r->count > l->list_max - l->numi)
+            return fail(ctx, GOPTFOO_ETOOMANY, it->base, it->tok, it->end,
+                        l->list_max);
+        for (i = 0; i < r->count; i++) {
+            range_value(r, i, &value);
+            if (list_call(l, &value) != 0)
+                return fail(ctx, GOPTFOO_ESTOPPED, it->base, it->tok,
+                            it->end, l->numi);
+            l->numi++;
+        }
+        return GOPTFOO_OK;
+    }
+
+    if (r->count > l->list_max - l->numi)
+        return fail(ctx, GOPTFOO_ETOOMANY, it->base, it->tok, it->end,
+                    l->list_max);
+    if (r->count > l->alloitems - l->numi) {
+        want = l->alloitems << 1;
+        if (want < l->numi + r->count)
+            want = l->numi + r->count;
+        if ((ret = list_reserve(ctx, l, want)) != GOPTFOO_OK)
+            return ret;
+    }
+
+    step = r->down ? 0 - (unsigned long long) r->step : r->step;
+    switch (type) {
+    case LIST_D:
+        for (i = 0; i < r->count; i++) {
+            range_value(r, i, &value);
+            ((double *) *l->items)[l->numi + i] = value.d;
+        }
+        break;
+    case LIST_LL:
+        x = (unsigned long long) r->first.ll;
+        for (i = 0; i < r->count; i++, x += step)
+            ((long long *) *l->items)[l->numi + i] = (long long) x;
+        break;
+    default:
+        x = r->first.ul;
+        for (i = 0; i < r->count; i++, x += step)
+            ((unsigned long *) *l->items)[l->numi + i] = (unsigned long) x;
+        break;
+    }
+    l->numi += r->count;
+    return GOPTFOO_OK;
+}
+
+/* check the values added to the list since from, and should one be
+ * out of bounds find its token by going over [p, end) again, this time
+ * checking each value; start is the index of the first value in that
+ * input. otherwise ret */
+static int list_recheck(struct goptfoo_ctx *ctx, struct list *l,
+                        const char *base, const char *p, const char *end,
+                        const size_t start, const size_t from, int ret)
+{
+    struct goptfoo_iter it;
+    union goptfoo_value value;
+    size_t bad;
+    int code = GOPTFOO_OK;
+
+    if (l->each || l->numi == from
+        || (bad = list_check(l, (char *) *l->items + from * l->size,
+                             l->numi - from, 1, &code)) == l->numi - from)
+        return ret;
+    iter_setup(&it, ctx, l->type, base, p, end, start);
+    it.min = l->min;
+    it.max = l->max;
+    while ((ret = iter_step(&it, &value)) > 0)
+        continue;
+    if (ret < 0)
+        return ctx->code;
+    return fail(ctx, code, NULL, NULL, NULL, from + bad);
+}
+
+#ifdef GOPTFOO_SWAR
+/* the common case of a list of plain decimal integers: tokens of at
+ * most 15 digits, with a '-' for long long, followed by whitespace. the
+ * digits come from two eight byte loads without a branch on how many
+ * there are, which the general scanner mispredicts as the lengths of
+ * the values vary. at most max values are stored at dst, and *pp is
+ * left at the first token that is anything else (a '+', an octal or hex
+ * prefix, a range, junk, or one too near the end for the loads) for
+ * iter_type_step to deal with */
+static gf_inline size_t list_plain(void *dst, const int type,
+                                   const int radix, const char **pp,
+                                   const char *end, const size_t max)
+{
+    const char *p = *pp;
+    uint64_t a, b, v;
+    unsigned int n1, n2, neg;
+    size_t i = 0;
+
+    for (;;) {
+        while (p < end && gf_isspace(*p))
+            p++;
+        if (i == max || end - p < 17)
+            break;
+        neg = type == LIST_LL && *p == '-';
+        memcpy(&a, p + neg, sizeof(a));
+        memcpy(&b, p + neg + 8, sizeof(b));
+        n1 = swar_ndigits8(a);
+        n2 = swar_ndigits8(b) & (0U - (n1 == 8));
+        if (n1 == 0 || n1 + n2 == 16 || !gf_isspace(p[neg + n1 + n2])
+            || (radix == 0 && p[neg] == '0' && n1 > 1))
+            break;
+        v = swar_digits8(a, n1) * pow10u[n2] + swar_digits8(b, n2);
+        if (type == LIST_LL)
+            ((long long *) dst)[i] = neg ? -(long long) v : (long long) v;
+        else if (v <= ULONG_MAX)
+            ((unsigned long *) dst)[i] = (unsigned long) v;
+        else
+            break;
+        p += neg + n1 + n2 + 1;
+        i++;
+    }
+    *pp = p;
+    return i;
+}
+#endif
+
+/* append the values in [p, end) to the list, or pass them to the
+ * callback; error offsets are relative to base. values for the list are
+ * checked against min and max once a block of them has been added, but
+ * callbacks must only ever see good values, so those are checked one
+ * by one */
+#define GOPTFOO_CHECK 4096
+
+static gf_inline int list_type_range(struct goptfoo_ctx *ctx,
+                                     struct list *l, const int type,
+                                     const int radix, const char *base,
+                                     const char *p, const char *end)
+{
+    struct goptfoo_iter it;
+    union goptfoo_value value;
+    size_t start = l->numi, checked = l->numi;
+    int ret, step;
+#ifdef GOPTFOO_SWAR
+    size_t n;
+#endif
+
+    iter_setup(&it, ctx, type, base, p, end, l->numi);
+    it.min = l->min;
+    it.max = l->max;
+
+    for (;;) {
+#ifdef GOPTFOO_SWAR
+        if (type != LIST_D && radix != 16 && !l->each
+            && l->numi - checked < GOPTFOO_CHECK) {
+            n = l->alloitems - l->numi;
+            if (n > GOPTFOO_CHECK - (l->numi - checked))
+                n = GOPTFOO_CHECK - (l->numi - checked);
+            n = list_plain((char *) *l->items + l->numi * l->size, type,
+                           radix, &it.p, end, n);
+            l->numi += n;
+            it.index += n;
+        }
+#endif
+        if (l->numi - checked >= GOPTFOO_CHECK) {
+            if ((ret = list_recheck(ctx, l, base, p, end, start, checked,
+                                    GOPTFOO_OK)) != GOPTFOO_OK)
+                return ret;
+            checked = l->numi;
+        }
+        if ((step = iter_type_step(&it, type, radix, &value, l->each)) <= 0)
+            break;
+        if (step == 2) {
+            if ((ret = list_expand(ctx, l, type, &it)) != GOPTFOO_OK)
+                return list_recheck(ctx, l, base, p, end, start, checked,
+                                    ret);
+        } else if (l->each) {
+            if (l->numi >= l->list_max)
+                return fail(ctx, GOPTFOO_ETOOMANY, base, it.tok, end,
+                            l->list_max);
+            if (list_call(l, &value) != 0)
+                return fail(ctx, GOPTFOO_ESTOPPED, base, it.tok, end,
+                            l->numi);
+            l->numi++;
+            continue;
+        } else {
+            if ((ret = list_grow(ctx, l->items, l->size, l->numi,
+                                 &l->alloitems,
+                                 l->list_max)) != GOPTFOO_OK) {
+                /* a bad value is reported ahead of there being no room */
+                it.index = l->numi;
+                if (iter_check(&it, type, &value) < 0)
+                    ret = ctx->code;
+                else if (ret == GOPTFOO_ETOOMANY)
+                    fail(ctx, ret, base, it.tok, end, l->numi);
+                return list_recheck(ctx, l, base, p, end, start, checked,
+                                    ret);
+            }
+            switch (type) {
+            case LIST_D:
+                ((double *) *l->items)[l->numi++] = value.d;
+                break;
+            case LIST_LL:
+                ((long long *) *l->items)[l->numi++] = value.ll;
+                break;
+            default:
+                ((unsigned long *) *l->items)[l->numi++] = value.ul;
+                break;
+            }
+        }
+    }
+    return list_recheck(ctx, l, base, p, end, start, checked,
+                        step < 0 ? ctx->code : GOPTFOO_OK);
+}
+
+/* narrow lists ******************************************************* */
+
+/* the int32_t, uint32_t, int16_t, uint8_t, and float lists are parsed as
+ * the wide type into a block on the stack, which is then checked and
+ * narrowed into the items all at once by loops simple enough for the
+ * compiler to vectorize. only should a block fail the checks are its
+ * values gone over one by one, to find the value at fault or, for
+ * floats, to round those that going via double might get wrong */
+
+#define GOPTFOO_BLOCK 256
+
+struct block {
+    union {
+        double d[GOPTFOO_BLOCK];
+        long long ll[GOPTFOO_BLOCK];
+        unsigned long ul[GOPTFOO_BLOCK];
+    } v;
+    const char *toks[GOPTFOO_BLOCK];
+    const char *range;          /* the token, if the values are a range */
+    size_t n;
+};
+
+/* the min and max of the list are within the type, so the bounds check
+ * of the wide values against them does for both */
+#define NARROW_INT(name, T, W, bounds)                                  \
+static gf_inline int name(T *dst, const W *src, const size_t n,         \
+                          const W min, const W max)                     \
+{                                                                       \
+    size_t i;                                                           \
+    if (!bounds(src, n, min, max))                                      \
+        return 0;                                                       \
+    for (i = 0; i < n; i++)                                             \
+        dst[i] = (T) src[i];                                            \
+    return 1;                                                           \
+}
+
+NARROW_INT(narrow_i32, int32_t, long long, bounds_ll)
+NARROW_INT(narrow_i16, int16_t, long long, bounds_ll)
+NARROW_INT(narrow_u32, uint32_t, unsigned long, bounds_ul)
+NARROW_INT(narrow_u8, uint8_t, unsigned long, bounds_ul)
+
+/* whether a double might not round to the same float as the decimal it
+ * came from did: a double exactly halfway between two floats may have
+ * been rounded there from either side, and outside the normal range of
+ * float the precision differs or there is overflow */
+static gf_inline int float_odd(const double d)
+{
+    uint64_t bits;
+    double a = fabs(d);
+
+    memcpy(&bits, &d, sizeof(bits));
+    return ((bits & 0x1fffffff) == 0x10000000)
+        | !(a <= FLT_MAX) | ((a < FLT_MIN) & (a != 0));
+}
+
+static gf_inline int narrow_f(float *dst, const double *src, const size_t n,
+                              const double min, const double max)
+{
+    int odd = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        odd |= float_odd(src[i]);
+    if (odd)
+        return 0;
+    for (i = 0; i < n; i++)
+        dst[i] = (float) src[i];
+    return bounds_f(dst, n, min, max, 1);
+}
+
+static gf_inline int block_narrow(struct list *l, struct block *b,
+                                  const size_t n)
+{
+    switch (l->type) {
+    case LIST_F:
+        return narrow_f((float *) *l->items + l->numi, b->v.d, n,
+                        l->min.d, l->max.d);
+    case LIST_I32:
+        return narrow_i32((int32_t *) * l->items + l->numi, b->v.ll, n,
+                          l->min.ll, l->max.ll);
+    case LIST_I16:
+        return narrow_i16((int16_t *) * l->items + l->numi, b->v.ll, n,
+                          l->min.ll, l->max.ll);
+    case LIST_U32:
+        return narrow_u32((uint32_t *) * l->items + l->numi, b->v.ul, n,
+                          l->min.ul, l->max.ul);
+    default:
+        return narrow_u8((uint8_t *) * l->items + l->numi, b->v.ul, n,
+                         l->min.ul, l->max.ul);
+    }
+}
+
+/* the values one at a time, failing on the first that does not fit or
+ * is out of bounds; only those below store are put into the items */
+static int block_slow(struct goptfoo_ctx *ctx, struct list *l,
+                      struct block *b, const size_t n, const size_t store,
+                      const char *base, const char *end)
+{
+    const char *tok, *ep;
+    long long ll, tmin, tmax;
+    unsigned long ul, umax;
+    double d;
+    float f;
+    size_t i;
+    int code, ret;
+
+    for (i = 0; i < n; i++) {
+        tok = b->range ? b->range : b->toks[i];
+        code = GOPTFOO_OK;
+        switch (l->type) {
+        case LIST_F:
+            d = b->v.d[i];
+            if (!b->range && float_odd(d)) {
+                if ((ret = scan_fd_slow(tok, end, &ep, &d, 1)) == SCAN_NOMEM)
+                    return fail_nomem(ctx, 0);
+                /* strtof(3) may also report the subnormals */
+                if (ret != SCAN_OK && !(ret == SCAN_RANGE && d != 0
+                                        && fabs(d) <= FLT_MAX)) {
+                    code = GOPTFOO_ERANGE;
+                    break;
+                }
+            } else if (fabs(d) > FLT_MAX && !isinf(d)) {
+                code = GOPTFOO_ERANGE;
+                break;
+            }
+            f = (float) d;
+            if (isfinite(l->min.d) && f < l->min.d)
+                code = GOPTFOO_EMIN;
+            else if (isfinite(l->max.d) && f > l->max.d)
+                code = GOPTFOO_EMAX;
+            else if (i < store)
+                ((float *) *l->items)[l->numi + i] = f;
+            break;
+        case LIST_I32:
+        case LIST_I16:
+            ll = b->v.ll[i];
+            tmin = l->type == LIST_I32 ? INT32_MIN : INT16_MIN;
+            tmax = l->type == LIST_I32 ? INT32_MAX : INT16_MAX;
+            if (ll < tmin || ll > tmax)
+                code = GOPTFOO_ERANGE;
+            else if (ll < l->min.ll)
+                code = GOPTFOO_EMIN;
+            else if (ll > l->max.ll)
+                code = GOPTFOO_EMAX;
+            else if (i < store && l->type == LIST_I32)
+                ((int32_t *) *l->items)[l->numi + i] = (int32_t) ll;
+            else if (i < store)
+                ((int16_t *) *l->items)[l->numi + i] = (int16_t) ll;
+            break;
+        default:
+            ul = b->v.ul[i];
+            umax = l->type == LIST_U32 ? UINT32_MAX : UINT8_MAX;
+            if (ul > umax)
+                code = GOPTFOO_ERANGE;
+            else if (ul < l->min.ul)
+                code = GOPTFOO_EMIN;
+            else if (ul > l->max.ul)
+                code = GOPTFOO_EMAX;
+            else if (i < store && l->type == LIST_U32)
+                ((uint32_t *) *l->items)[l->numi + i] = (uint32_t) ul;
+            else if (i < store)
+                ((uint8_t *) *l->items)[l->numi + i] = (uint8_t) ul;
+            break;
+        }
+        if (code != GOPTFOO_OK)
+            return fail(ctx, code, base, tok, end, l->numi + i);
+    }
+    return GOPTFOO_OK;
+}
+
+static int block_flush(struct goptfoo_ctx *ctx, struct list *l,
+                       struct block *b, const char *base, const char *end)
+{
+    size_t n = b->n, room = l->list_max - l->numi, want;
+    int ok, ret;
+
+    if (n == 0)
+        return GOPTFOO_OK;
+    b->n = 0;
+
+    /* any bad value up to and including the first that does not fit is
+     * the error, as it would be for the other lists */
+    if (n > room) {
+        if ((ret = block_slow(ctx, l, b, room + 1, 0, base, end))
+            != GOPTFOO_OK)
+            return ret;
+        return fail(ctx, GOPTFOO_ETOOMANY, base,
+                    b->range ? b->range : b->toks[room], end, l->list_max);
+    }
+    if (n > l->alloitems - l->numi) {
+        want = l->alloitems << 1;
+        if (want < l->numi + n)
+            want = l->numi + n;
+        if ((ret = list_reserve(ctx, l, want)) != GOPTFOO_OK)
+            return ret;
+    }
+
+    /* full blocks are of a constant size, and so need no scalar tail */
+    ok = n == GOPTFOO_BLOCK ? block_narrow(l, b, GOPTFOO_BLOCK)
+        : block_narrow(l, b, n);
+    if (!ok && (ret = block_slow(ctx, l, b, n, n, base, end)) != GOPTFOO_OK)
+        return ret;
+    l->numi += n;
+    return GOPTFOO_OK;
+}
+
+/* a range is checked by its ends and count before going into the list
+ * a block at a time */
+static int block_expand(struct goptfoo_ctx *ctx, struct list *l,
+                        const int type, struct block *b,
+                        const struct goptfoo_iter *it)
+{
+    const struct goptfoo_range *r = &it->range;
+    union goptfoo_value value;
+    size_t i = 0;
+    int ret;
+
+    b->range = it->tok;
+    b->n = 2;
+    switch (type) {
+    case LIST_D:
+        b->v.d[0] = r->first.d;
+        b->v.d[1] = r->last.d;
+        break;
+    case LIST_LL:
+        b->v.ll[0] = r->first.ll;
+        b->v.ll[1] = r->last.ll;
+        break;
+    default:
+        b->v.ul[0] = r->first.ul;
+        b->v.ul[1] = r->last.ul;
+        break;
+    }
+    if ((ret = block_slow(ctx, l, b, 2, 0, it->base, it->end))
+        != GOPTFOO_OK) {
+        ctx->index = l->numi;
+        return ret;
+    }
+    if (r->count > l->list_max - l->numi)
+        return fail(ctx, GOPTFOO_ETOOMANY, it->base, it->tok, it->end,
+                    l->list_max);
+
+    while (i < r->count) {
+        for (b->n = 0; b->n < GOPTFOO_BLOCK && i < r->count; b->n++, i++) {
+            range_value(r, i, &value);
+            switch (type) {
+            case LIST_D:
+                b->v.d[b->n] = value.d;
+                break;
+            case LIST_LL:
+                b->v.ll[b->n] = value.ll;
+                break;
+            default:
+                b->v.ul[b->n] = value.ul;
+                break;
+            }
+        }
+        if ((ret = block_flush(ctx, l, b, it->base, it->end)) != GOPTFOO_OK)
+            return ret;
+    }
+    b->range = NULL;
+    return GOPTFOO_OK;
+}
+
+/* as list_type_range, where type is the wide type the values are
+ * parsed as */
+static gf_inline int list_narrow_range(struct goptfoo_ctx *ctx,
+                                       struct list *l, const int type,
+                                       const int radix, const char *base,
+                                       const char *p, const char *end)
+{
+    struct goptfoo_iter it;
+    union goptfoo_value value;
+    struct block b;
+    int ret, step;
+
+    /* the bounds are left to the blocks */
+    iter_setup(&it, ctx, type, base, p, end, l->numi);
+    switch (type) {
+    case LIST_D:
+        it.min.d = -INFINITY;
+        it.max.d = INFINITY;
+        break;
+    case LIST_LL:
+        it.min.ll = LLONG_MIN;
+        it.max.ll = LLONG_MAX;
+        break;
+    default:
+        it.min.ul = 0;
+        it.max.ul = ULONG_MAX;
+        break;
+    }
+    b.n = 0;
+    b.range = NULL;
+
+    for (;;) {
+        if ((step = iter_type_step(&it, type, radix, &value, 0)) == 1) {
+            switch (type) {
+            case LIST_D:
+                b.v.d[b.n] = value.d;
+                break;
+            case LIST_LL:
+                b.v.ll[b.n] = value.ll;
+                break;
+            default:
+                b.v.ul[b.n] = value.ul;
+                break;
+            }
+            b.toks[b.n++] = it.tok;
+            if (b.n == GOPTFOO_BLOCK
+                && (ret = block_flush(ctx, l, &b, base, end)) != GOPTFOO_OK)
+                return ret;
+            continue;
+        }
+        /* values before an error or range go in first */
+        if ((ret = block_flush(ctx, l, &b, base, end)) != GOPTFOO_OK)
+            return ret;
+        if (step == 0)
+            return GOPTFOO_OK;
+        if (step < 0)
+            return ctx->code;
+        if ((ret = block_expand(ctx, l, type, &b, &it)) != GOPTFOO_OK)
+            return ret;
+    }
+}
+
+/* the integer lists get a kernel for each radix */
+#define LIST_RADIX(fn, type)                                            \
+    (radix == 10 ? fn(ctx, l, type, 10, base, p, end)                   \
+     : radix == 16 ? fn(ctx, l, type, 16, base, p, end)                 \
+     : fn(ctx, l, type, 0, base, p, end))
+
+static int list_range(struct goptfoo_ctx *ctx, struct list *l,
+                      const char *base, const char *p, const char *end)
+{
+    const int radix = flags_radix(ctx->flags);
+
+    STATS_BYTES(end - p);
+    switch (l->type) {
+    case LIST_D:
+        return list_type_range(ctx, l, LIST_D, 0, base, p, end);
+    case LIST_LL:
+        return LIST_RADIX(list_type_range, LIST_LL);
+    case LIST_UL:
+        return LIST_RADIX(list_type_range, LIST_UL);
+    case LIST_F:
+        return list_narrow_range(ctx, l, LIST_D, 0, base, p, end);
+    case LIST_I32:
+    case LIST_I16:
+        return LIST_RADIX(list_narrow_range, LIST_LL);
+    default:
+        return LIST_RADIX(list_narrow_range, LIST_UL);
+    }
+}
+
+/* threads ************************************************************ */
+
+/* with ctx->threads above one, inputs of at least ctx->thread_min bytes
+ * are cut into that many chunks at whitespace, each parsed by its own
+ * thread into its own list, and the results then copied in order into
+ * the caller's list. threads are started for each call rather than kept
+ * in a pool, as that would be global state, and the cost of starting a
+ * few is small next to parsing a megabyte. error offsets are from the
+ * start of the whole input, and the first error in input order wins */
+
+#ifdef HAVE_PTHREAD
+#define GOPTFOO_THREAD_MAX 64
+
+struct chunk {
+    struct goptfoo_ctx ctx;
+    struct list l;
+    void *items;
+    const char *base;
+    const char *p;
+    const char *end;
+    int ret;
+};
+
+static void *chunk_parse(void *arg)
+{
+    struct chunk *c = arg;
+    c->ret = list_reserve_for(&c->ctx, &c->l, c->p, c->end);
+    if (c->ret == GOPTFOO_OK)
+        c->ret = list_range(&c->ctx, &c->l, c->base, c->p, c->end);
+    return NULL;
+}
+
+static int list_threaded(struct goptfoo_ctx *ctx, struct list *l,
+                         const char *p, const char *end, unsigned int n)
+{
+    struct chunk chunks[GOPTFOO_THREAD_MAX];
+    pthread_t tids[GOPTFOO_THREAD_MAX];
+    int started[GOPTFOO_THREAD_MAX];
+    const char *cut = p;
+    size_t len = (size_t) (end - p), total = 0;
+    unsigned int i, k;
+    int ret = GOPTFOO_OK;
+
+    for (i = 0; i < n; i++) {
+        struct chunk *c = &chunks[i];
+        c->ctx = *ctx;
+        c->ctx.code = GOPTFOO_OK;
+        c->l = *l;
+        c->items = NULL;
+        c->l.items = &c->items;
+        c->l.numi = c->l.alloitems = 0;
+        c->l.fixed = 0;
+        c->l.list_max = l->list_max - l->numi;
+        c->base = p;
+        c->p = cut;
+        if (i == n - 1) {
+            cut = end;
+        } else {
+            const char *want = p + len / n * (i + 1);
+            if (want > cut)
+                cut = want;
+            while (cut < end && !gf_isspace(*cut))
+                cut++;
+        }
+        c->end = cut;
+        started[i] = i > 0
+            && pthread_create(&tids[i], NULL, chunk_parse, c) == 0;
+    }
+    chunk_parse(&chunks[0]);
+    for (i = 1; i < n; i++) {
+        if (started[i])
+            pthread_join(tids[i], NULL);
+        else
+            chunk_parse(&chunks[i]);
+    }
+
+    /* too many values is redone in order from that chunk on so that the
+     * error lands on the right token, as a later chunk might otherwise
+     * have been the one to report it */
+    for (k = 0; k < n; k++) {
+        if (chunks[k].ret == GOPTFOO_ETOOMANY
+            || chunks[k].l.numi > l->list_max - l->numi - total)
+            break;
+        if (chunks[k].ret != GOPTFOO_OK) {
+            *ctx = chunks[k].ctx;
+            ctx->index += l->numi + total;
+            ret = ctx->code;
+            break;
+        }
+        total += chunks[k].l.numi;
+    }
+
+    if (ret == GOPTFOO_OK && l->numi + total >= l->alloitems)
+        ret = list_reserve(ctx, l, l->numi + total);
+    if (ret == GOPTFOO_OK) {
+        for (i = 0; i < k; i++) {
+            memcpy((char *) *l->items + l->numi * l->size, chunks[i].items,
+                   chunks[i].l.numi * l->size);
+            l->numi += chunks[i].l.numi;
+        }
+        if (k < n)
+            ret = list_range(ctx, l, p, chunks[k].p, end);
+    }
+
+    for (i = 0; i < n; i++)
+        items_free(ctx->alloc, chunks[i].items,
+                   chunks[i].l.alloitems * l->size);
+    return ret;
+}
+#endif
+
+/* parse the contiguous input [p, end), threaded if so configured */
+static int list_bulk(struct goptfoo_ctx *ctx, struct list *l,
+                     const char *p, const char *end)
+{
+    int ret;
+#ifdef HAVE_PTHREAD
+    unsigned int n = ctx->threads;
+    size_t min = ctx->thread_min ? ctx->thread_min : GOPTFOO_THREAD_MIN;
+
+    if (n > GOPTFOO_THREAD_MAX)
+        n = GOPTFOO_THREAD_MAX;
+    /* callbacks must see the values in order */
+    if (n > 1 && !l->each && (size_t) (end - p) >= min
+        && (size_t) (end - p) >= n)
+        return list_threaded(ctx, l, p, end, n);
+#endif
+    if ((ret = list_reserve_for(ctx, l, p, end)) == GOPTFOO_OK)
+        ret = list_range(ctx, l, p, p, end);
+    return ret;
+}
+
+/* streams ************************************************************ */
+
+/* input that arrives in pieces is parsed as far as the last whitespace
+ * in each piece, and the rest, a token that may have been split, is
+ * carried over to be completed by the next piece or at the end. error
+ * offsets are from the start of the stream */
+
+struct goptfoo_stream {
+    struct goptfoo_ctx *ctx;
+    struct list *l;
+    struct list list;           /* for goptfoo_stream_* streams */
+    size_t *numitems;
+    char *carry;
+    size_t clen, ccap;
+    size_t done;                /* bytes before the carry */
+    int ret;
+};
+
+static int stream_init(struct goptfoo_ctx *ctx, struct goptfoo_stream *s,
+                       struct list *l)
+{
+    s->ctx = ctx;
+    s->l = l;
+    s->carry = NULL;
+    s->clen = s->ccap = s->done = 0;
+    return s->ret = list_reserve_for(ctx, l, NULL, NULL);
+}
+
+static int stream_carry(struct goptfoo_stream *s, const char *p,
+                        const char *end)
+{
+    size_t len = (size_t) (end - p), want;
+    char *nc;
+    int ret;
+
+    if (len == 0)
+        return GOPTFOO_OK;
+    if (s->clen + len > s->ccap) {
+        want = s->ccap ? s->ccap << 1 : 64;
+        if (want < s->clen + len)
+            want = s->clen + len;
+        if ((nc = mem_resize(s->carry, s->ccap, want, &ret)) == NULL)
+            return s->ret = fail_alloc(s->ctx, ret, 0);
+        s->carry = nc;
+        s->ccap = want;
+    }
+    memcpy(s->carry + s->clen, p, len);
+    s->clen += len;
+    return GOPTFOO_OK;
+}
+
+static int stream_range(struct goptfoo_stream *s, const char *p,
+                        const char *end)
+{
+    if ((s->ret = list_range(s->ctx, s->l, p, p, end)) != GOPTFOO_OK)
+        s->ctx->offset += s->done;
+    s->done += (size_t) (end - p);
+    return s->ret;
+}
+
+static int stream_feed(struct goptfoo_stream *s, const char *buf,
+                       const size_t len)
+{
+    const char *p = buf, *end = buf + len, *cut;
+
+    if (s->ret != GOPTFOO_OK)
+        return s->ret;
+
+    /* complete a token left over from the previous piece */
+    if (s->clen > 0) {
+        for (cut = p; cut < end && !gf_isspace(*cut); cut++) ;
+        if (stream_carry(s, p, cut) != GOPTFOO_OK || cut == end)
+            return s->ret;
+        if (stream_range(s, s->carry, s->carry + s->clen) != GOPTFOO_OK)
+            return s->ret;
+        s->clen = 0;
+        p = cut;
+    }
+
+    for (cut = end; cut > p && !gf_isspace(cut[-1]); cut--) ;
+    if (cut > p && stream_range(s, p, cut) != GOPTFOO_OK)
+        return s->ret;
+    return stream_carry(s, cut, end);
+}
+
+static int stream_end(struct goptfoo_stream *s)
+{
+    if (s->ret == GOPTFOO_OK && s->clen > 0)
+        stream_range(s, s->carry, s->carry + s->clen);
+    mem_free(s->carry, s->ccap);
+    s->carry = NULL;
+    s->ccap = 0;
+    return s->ret;
+}
+
+/* parse cache ******************************************************** */
+
+/* with ctx->cache_dir set, lists of at least GOPTFOO_CACHE_MIN bytes are
+ * kept once parsed in a file named for a hash of everything that went
+ * into them: the type, the bounds, the flags that change how the input
+ * is read, and the input itself (or for @path, the identity of the file:
+ * device, inode, size, and times). a later parse of the same thing maps
+ * the file instead. entries are written to a temporary file and renamed
+ * into place, so concurrent writers at worst replace one good entry with
+ * another. anything odd about an entry and the list is parsed as usual;
+ * the cache never turns a good parse into an error */
+
+#define GOPTFOO_CACHE_VERSION 1
+#define GOPTFOO_CACHE_MIN 65536
+#define GOPTFOO_CACHE_ORDER 0x01020304U
+
+struct cache_head {
+    char magic[8];
+    uint32_t version;
+    uint32_t order;             /* GOPTFOO_CACHE_ORDER, as written */
+    uint32_t type;
+    uint32_t size;
+    uint64_t key[2];
+    uint64_t numitems;
+    uint64_t reserved[2];       /* and the items from offset 64 */
+};
+
+static const char cache_magic[8] = "goptfoo";
+
+static inline uint64_t cache_fmix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint64_t cache_round(uint64_t acc, const uint64_t w)
+{
+    acc += w * 0xC2B2AE3D27D4EB4FULL;
+    acc = (acc << 31) | (acc >> 33);
+    return acc * 0x9E3779B185EBCA87ULL;
+}
+
+/* four independent lanes of eight bytes (the xxHash64 round), as the
+ * input can run to megabytes; this need only tell inputs apart */
+static void cache_mix(uint64_t key[2], const void *buf, size_t len)
+{
+    const unsigned char *p = buf;
+    uint64_t v0 = key[0], v1 = key[1], v2 = ~key[0], v3 = key[1] + len, w;
+
+    for (; len >= 32; p += 32, len -= 32) {
+        memcpy(&w, p, sizeof(w));
+        v0 = cache_round(v0, w);
+        memcpy(&w, p + 8, sizeof(w));
+        v1 = cache_round(v1, w);
+        memcpy(&w, p + 16, sizeof(w));
+        v2 = cache_round(v2, w);
+        memcpy(&w, p + 24, sizeof(w));
+        v3 = cache_round(v3, w);
+    }
+    for (; len >= 8; p += 8, len -= 8) {
+        memcpy(&w, p, sizeof(w));
+        v0 = cache_round(v0, w);
+    }
+    w = (uint64_t) len << 56;
+    memcpy(&w, p, len);
+    v1 = cache_round(v1, w);
+    key[0] = cache_fmix(v0 ^ ((v2 << 17) | (v2 >> 47)));
+    key[1] = cache_fmix(v1 ^ ((v3 << 29) | (v3 >> 35)) ^ key[0]);
+}
+
+static void cache_mix_u64(uint64_t key[2], const uint64_t v)
+{
+    cache_mix(key, &v, sizeof(v));
+}
+
+/* 0 and the key, or -1 should the list not be worth caching */
+static int cache_key(const struct goptfoo_ctx *ctx, const struct list *l,
+                     const char *arg, uint64_t key[2])
+{
+    struct stat st;
+
+    key[0] = GOPTFOO_CACHE_VERSION;
+    key[1] = 0;
+    cache_mix_u64(key, (uint64_t) l->type);
+    cache_mix_u64(key, ctx->flags & (GOPTFOO_RANGES | GOPTFOO_DEC
+                                     | GOPTFOO_HEX));
+    switch (l->type) {
+    case LIST_D:
+    case LIST_F:
+        cache_mix(key, &l->min.d, sizeof(l->min.d));
+        cache_mix(key, &l->max.d, sizeof(l->max.d));
+        break;
+    case LIST_LL:
+    case LIST_I32:
+    case LIST_I16:
+        cache_mix_u64(key, (uint64_t) l->min.ll);
+        cache_mix_u64(key, (uint64_t) l->max.ll);
+        break;
+    default:
+        cache_mix_u64(key, (uint64_t) l->min.ul);
+        cache_mix_u64(key, (uint64_t) l->max.ul);
+    }
+
+    if (*arg != '@') {
+        size_t len = strlen(arg);
+        if (len < GOPTFOO_CACHE_MIN)
+            return -1;
+        cache_mix(key, arg, len);
+        return 0;
+    }
+    /* @- cannot be read twice, and @bin: is no slower than the cache */
+    if (strcmp(arg, "@-") == 0 || strncmp(arg, "@bin:", 5) == 0
+        || stat(arg + 1, &st) < 0 || !S_ISREG(st.st_mode)
+        || st.st_size < GOPTFOO_CACHE_MIN)
+        return -1;
+    cache_mix_u64(key, 0x40);
+    cache_mix_u64(key, (uint64_t) st.st_dev);
+    cache_mix_u64(key, (uint64_t) st.st_ino);
+    cache_mix_u64(key, (uint64_t) st.st_size);
+    cache_mix_u64(key, (uint64_t) st.st_mtime);
+    cache_mix_u64(key, (uint64_t) st.st_ctime);
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    cache_mix_u64(key, (uint64_t) st.st_mtim.tv_nsec);
+    cache_mix_u64(key, (uint64_t) st.st_ctim.tv_nsec);
+#endif
+    return 0;
+}
+
+/* the path of an entry, or of a temporary file for it with tmp set */
+static char *cache_path(const struct goptfoo_ctx *ctx, const uint64_t key[2],
+                        const int tmp)
+{
+    size_t len = strlen(ctx->cache_dir) + 64;
+    char *path;
+
+    if ((path = malloc(len)) == NULL)
+        return NULL;
+    if (tmp)
+        snprintf(path, len, "%s/.goptfoo-XXXXXX", ctx->cache_dir);
+    else
+        snprintf(path, len, "%s/goptfoo-%016llx%016llx", ctx->cache_dir,
+                 (unsigned long long) key[0], (unsigned long long) key[1]);
+    return path;
+}
+
+static int cache_read(int fd, void *buf, size_t len, off_t offset)
+{
+    char *p = buf;
+    ssize_t got;
+
+    while (len > 0) {
+        if ((got = pread(fd, p, len, offset)) <= 0) {
+            if (got < 0 && errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += got;
+        len -= (size_t) got;
+        offset += got;
+    }
+    return 0;
+}
+
+static int cache_write(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    ssize_t put;
+
+    while (len > 0) {
+        if ((put = write(fd, p, len)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += put;
+        len -= (size_t) put;
+    }
+    return 0;
+}
+
+/* GOPTFOO_OK should the entry have been used, -1 to parse the list, or
+ * an error from making room for the values. views map the entry, while
+ * lists read it straight into the items */
+static int cache_load(struct goptfoo_ctx *ctx, struct list *l,
+                      const uint64_t key[2], struct goptfoo_view *view)
+{
+    struct cache_head head;
+    struct stat st;
+    size_t len, n;
+    char *map, *path;
+    int fd, flags = O_RDONLY, ret = -1;
+
+#ifdef O_NOFOLLOW
+    flags |= O_NOFOLLOW;
+#endif
+    if ((path = cache_path(ctx, key, 0)) == NULL)
+        return -1;
+    fd = open(path, flags);
+    free(path);
+    if (fd < 0)
+        return -1;
+    /* entries written by anyone else are not to be trusted */
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)
+        || st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH))
+        || (uintmax_t) st.st_size < sizeof(head)
+        || (uintmax_t) st.st_size > SIZE_MAX
+        || cache_read(fd, &head, sizeof(head), 0) < 0)
+        goto DONE;
+
+    len = (size_t) st.st_size;
+    n = (size_t) head.numitems;
+    if (memcmp(head.magic, cache_magic, sizeof(cache_magic)) != 0
+        || head.version != GOPTFOO_CACHE_VERSION
+        || head.order != GOPTFOO_CACHE_ORDER
+        || head.type != (uint32_t) l->type || head.size != l->size
+        || head.key[0] != key[0] || head.key[1] != key[1]
+        || head.numitems > (len - sizeof(head)) / l->size
+        || n * l->size != len - sizeof(head)
+        || n > l->list_max - l->numi)
+        goto DONE;
+
+    if (view && l->numi == 0) {
+        if ((map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0))
+            == MAP_FAILED)
+            goto DONE;
+        *l->items = map;
+        view->items = map + sizeof(head);
+        view->maplen = len;
+        l->numi = n;
+        ret = GOPTFOO_OK;
+        goto DONE;
+    }
+    if ((l->numi + n > l->alloitems || !*l->items)
+        && (ret = list_reserve(ctx, l, l->numi + n)) != GOPTFOO_OK)
+        goto DONE;
+    /* a short read, say from a file truncated since, is a miss */
+    if (cache_read(fd, (char *) *l->items + l->numi * l->size, n * l->size,
+                   sizeof(head)) < 0) {
+        ret = -1;
+        goto DONE;
+    }
+    l->numi += n;
+    ret = GOPTFOO_OK;
+  DONE:
+    close(fd);
+    return ret;
+}
+
+/* keep the values from index start on; failures are ignored as the list
+ * is already parsed */
+static void cache_store(const struct goptfoo_ctx *ctx, const struct list *l,
+                        const uint64_t key[2], const size_t start)
+{
+    struct cache_head head;
+    char *path, *tmp;
+    int fd, saved = errno;
+
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, cache_magic, sizeof(cache_magic));
+    head.version = GOPTFOO_CACHE_VERSION;
+    head.order = GOPTFOO_CACHE_ORDER;
+    head.type = (uint32_t) l->type;
+    head.size = (uint32_t) l->size;
+    head.key[0] = key[0];
+    head.key[1] = key[1];
+    head.numitems = l->numi - start;
+
+    if ((tmp = cache_path(ctx, key, 1)) == NULL)
+        return;
+    if ((path = cache_path(ctx, key, 0)) == NULL
+        || (fd = mkstemp(tmp)) < 0) {
+        free(path);
+        free(tmp);
+        errno = saved;
+        return;
+    }
+    /* fsync(2) so that a crash cannot leave a short entry in place */
+    if (cache_write(fd, &head, sizeof(head)) < 0
+        || cache_write(fd, (const char *) *l->items + start * l->size,
+                       (l->numi - start) * l->size) < 0 || fsync(fd) < 0) {
+        close(fd);
+        unlink(tmp);
+    } else if (close(fd) < 0 || rename(tmp, path) < 0) {
+        unlink(tmp);
+    }
+    free(path);
+    free(tmp);
+    errno = saved;
+}
+
+/* binary input ******************************************************* */
+
+/* @bin:FORMAT:path reads packed values without any parsing: f64le for
+ * little-endian doubles, i16be for big-endian int16_t, u8 for bytes,
+ * and so forth, which must match the type of the list. values in the
+ * other byte order are swapped as they are copied, and the checks
+ * against min and max are reductions over many values at a time. error
+ * offsets are in bytes from the start of the file, and the token is
+ * empty */
+
+#define GOPTFOO_CHUNK 65536
+
+static int bin_little(void)
+{
+    const uint16_t one = 1;
+    unsigned char c;
+
+    memcpy(&c, &one, 1);
+    return c == 1;
+}
+
+/* the shifts are recognized as byte swap instructions */
+static gf_inline uint16_t swap16(uint16_t x)
+{
+    return (uint16_t) (x >> 8 | x << 8);
+}
+
+static gf_inline uint32_t swap32(uint32_t x)
+{
+    x = x >> 16 | x << 16;
+    return (x & 0xff00ff00UL) >> 8 | (x & 0x00ff00ffUL) << 8;
+}
+
+static gf_inline uint64_t swap64(uint64_t x)
+{
+    x = x >> 32 | x << 32;
+    x = (x & 0xffff0000ffff0000ULL) >> 16 | (x & 0x0000ffff0000ffffULL) << 16;
+    return (x & 0xff00ff00ff00ff00ULL) >> 8 | (x & 0x00ff00ff00ff00ffULL) << 8;
+}
+
+#define SWAP_LOOP(T, swapfn)                                            \
+    for (i = 0; i < n; i++) {                                           \
+        T x;                                                            \
+        memcpy(&x, src + i * sizeof(T), sizeof(T));                     \
+        x = swapfn(x);                                                  \
+        memcpy((char *) dst + i * sizeof(T), &x, sizeof(T));            \
+    }
+
+static void bin_copy(void *dst, const char *src, const size_t n,
+                     const size_t size, const int swap)
+{
+    size_t i;
+
+    if (!swap) {
+        memcpy(dst, src, n * size);
+        return;
+    }
+    switch (size) {
+    case 2:
+        SWAP_LOOP(uint16_t, swap16);
+        break;
+    case 4:
+        SWAP_LOOP(uint32_t, swap32);
+        break;
+    default:
+        SWAP_LOOP(uint64_t, swap64);
+        break;
+    }
+}
+
+/* FORMAT:path for the list, or -1 if the format does not suit it */
+static int bin_format(const struct list *l, const char *spec, int *swap,
+                      const char **path)
+{
+    const char *p = spec + 1;
+    unsigned int bits = 0;
+    int little = 1, kind;
+
+    while (gf_isdigit(*p) && bits < 1000)
+        bits = bits * 10 + (unsigned int) (*p++ - '0');
+    if (p[0] == 'l' && p[1] == 'e') {
+        p += 2;
+    } else if (p[0] == 'b' && p[1] == 'e') {
+        little = 0;
+        p += 2;
+    } else if (bits != 8) {
+        return -1;
+    }
+    if (*p != ':')
+        return -1;
+
+    switch (l->type) {
+    case LIST_D:
+    case LIST_F:
+        kind = 'f';
+        break;
+    case LIST_LL:
+    case LIST_I32:
+    case LIST_I16:
+        kind = 'i';
+        break;
+    default:
+        kind = 'u';
+        break;
+    }
+    if (*spec != kind || bits != l->size * CHAR_BIT)
+        return -1;
+    *swap = l->size > 1 && little != bin_little();
+    *path = p + 1;
+    return 0;
+}
+
+static int bin_fail(struct goptfoo_ctx *ctx, const int code,
+                    const size_t index, const size_t offset)
+{
+    fail(ctx, code, NULL, NULL, NULL, index);
+    ctx->offset = offset;
+    return code;
+}
+
+/* the values for a goptfoo_each_* list go by way of a block on the
+ * stack, so that the callback sees only checked values */
+static int bin_each(struct goptfoo_ctx *ctx, struct list *l,
+                    const char *src, const size_t n, const int swap,
+                    const size_t offset)
+{
+    union {
+        double d[GOPTFOO_BLOCK];
+        long long ll[GOPTFOO_BLOCK];
+        unsigned long ul[GOPTFOO_BLOCK];
+    } buf;
+    union goptfoo_value value;
+    size_t i, j, k, bad;
+    int code = GOPTFOO_OK;
+
+    for (i = 0; i < n; i += k) {
+        k = n - i < GOPTFOO_BLOCK ? n - i : GOPTFOO_BLOCK;
+        bin_copy(&buf, src + i * l->size, k, l->size, swap);
+        bad = list_check(l, &buf, k, 0, &code);
+        for (j = 0; j < bad; j++) {
+            if (l->numi >= l->list_max)
+                return bin_fail(ctx, GOPTFOO_ETOOMANY, l->list_max,
+                                offset + (i + j) * l->size);
+            list_value(l, &buf, j, &value);
+            if (list_call(l, &value) != 0)
+                return bin_fail(ctx, GOPTFOO_ESTOPPED, l->numi,
+                                offset + (i + j) * l->size);
+            l->numi++;
+        }
+        if (bad < k)
+            return bin_fail(ctx, code, l->numi,
+                            offset + (i + bad) * l->size);
+    }
+    return GOPTFOO_OK;
+}
+
+/* append the n packed values at src, which are at offset in the input */
+static int bin_append(struct goptfoo_ctx *ctx, struct list *l,
+                      const char *src, const size_t n, const int swap,
+                      const size_t offset)
+{
+    size_t room = l->list_max - l->numi, k = n < room ? n : room;
+    size_t bad, want;
+    char *dst;
+    int code = GOPTFOO_OK, ret;
+
+    STATS_BYTES(n * l->size);
+    if (l->each)
+        return bin_each(ctx, l, src, n, swap, offset);
+    if (k > 0) {
+        if (k > l->alloitems - l->numi) {
+            want = l->alloitems << 1;
+            if (want < l->numi + k)
+                want = l->numi + k;
+            if ((ret = list_reserve(ctx, l, want)) != GOPTFOO_OK)
+                return ret;
+        }
+        dst = (char *) *l->items + l->numi * l->size;
+        bin_copy(dst, src, k, l->size, swap);
+        if ((bad = list_check(l, dst, k, 0, &code)) < k)
+            return bin_fail(ctx, code, l->numi + bad,
+                            offset + bad * l->size);
+        l->numi += k;
+    }
+    if (k < n)
+        return bin_fail(ctx, GOPTFOO_ETOOMANY, l->list_max,
+                        offset + k * l->size);
+    return GOPTFOO_OK;
+}
+
+/* pipes and such; a partial value is kept for the next read */
+static int bin_fd(struct goptfoo_ctx *ctx, struct list *l, int fd,
+                  const int swap)
+{
+    char *buf;
+    size_t have = 0, n, offset = 0;
+    ssize_t got;
+    int ret;
+
+    if ((buf = mem_resize(NULL, 0, GOPTFOO_CHUNK, &ret)) == NULL)
+        return fail_alloc(ctx, ret, 0);
+    while ((got = read(fd, buf + have, GOPTFOO_CHUNK - have)) != 0) {
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            ret = fail(ctx, GOPTFOO_EFILE, NULL, NULL, NULL, l->numi);
+            ctx->oserr = errno;
+            break;
+        }
+        have += (size_t) got;
+        n = have / l->size;
+        if ((ret = bin_append(ctx, l, buf, n, swap, offset)) != GOPTFOO_OK)
+            break;
+        offset += n * l->size;
+        have -= n * l->size;
+        memmove(buf, buf + n * l->size, have);
+    }
+    if (ret == GOPTFOO_OK && have > 0)
+        ret = bin_fail(ctx, GOPTFOO_EFORMAT, l->numi, offset);
+    mem_free(buf, GOPTFOO_CHUNK);
+    return ret;
+}
+
+/* with a view, a file in the native byte order is not copied at all but
+ * left mapped for the caller */
+static int list_binary(struct goptfoo_ctx *ctx, struct list *l,
+                       const char *spec, struct goptfoo_view *view)
+{
+    const char *path;
+    struct stat st;
+    size_t len, n, bad;
+    char *map;
+    int fd, swap, ret, code = GOPTFOO_OK;
+
+    if (bin_format(l, spec, &swap, &path) < 0)
+        return fail(ctx, GOPTFOO_EFORMAT, spec, spec,
+                    spec + strcspn(spec, ":"), 0);
+    if (strcmp(path, "-") == 0)
+        return bin_fd(ctx, l, STDIN_FILENO, swap);
+
+    if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+        ret = fail(ctx, GOPTFOO_EFILE, NULL, NULL, NULL, 0);
+        ctx->oserr = errno;
+        if (fd >= 0)
+            close(fd);
+        return ret;
+    }
+    if (S_ISREG(st.st_mode) && st.st_size > 0
+        && (uintmax_t) st.st_size <= SIZE_MAX
+        && (map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+                       fd, 0)) != MAP_FAILED) {
+        close(fd);
+        len = (size_t) st.st_size;
+        n = len / l->size;
+        if (len % l->size != 0) {
+            ret = bin_fail(ctx, GOPTFOO_EFORMAT, l->numi + n, n * l->size);
+        } else if (view && !swap) {
+            if (n > l->list_max - l->numi) {
+                ret = bin_fail(ctx, GOPTFOO_ETOOMANY, l->list_max,
+                               (l->list_max - l->numi) * l->size);
+            } else if ((bad = list_check(l, map, n, 0, &code)) < n) {
+                ret = bin_fail(ctx, code, bad, bad * l->size);
+            } else {
+                STATS_BYTES(len);
+                *l->items = map;
+                view->maplen = len;
+                l->numi = n;
+                return GOPTFOO_OK;
+            }
+        } else {
+#ifdef MADV_SEQUENTIAL
+            madvise(map, len, MADV_SEQUENTIAL);
+#endif
+            ret = bin_append(ctx, l, map, n, swap, 0);
+        }
+        munmap(map, len);
+        return ret;
+    }
+    ret = bin_fd(ctx, l, fd, swap);
+    close(fd);
+    return ret;
+}
+
+/* @path input; regular files are parsed straight out of a mapping of
+ * the file, anything else (pipes, or should mmap(2) fail) is read in
+ * chunks and streamed. error offsets are from the start of the file or
+ * stream */
+
+static int list_fd_chunks(struct goptfoo_ctx *ctx, struct list *l, int fd)
+{
+    struct goptfoo_stream s;
+    char *buf;
+    ssize_t got;
+    int ret;
+
+    if ((buf = mem_resize(NULL, 0, GOPTFOO_CHUNK, &ret)) == NULL)
+        return fail_alloc(ctx, ret, 0);
+    if ((ret = stream_init(ctx, &s, l)) != GOPTFOO_OK) {
+        mem_free(buf, GOPTFOO_CHUNK);
+        return ret;
+    }
+
+    while ((got = read(fd, buf, GOPTFOO_CHUNK)) != 0) {
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            s.ret = fail(ctx, GOPTFOO_EFILE, NULL, NULL, NULL, l->numi);
+            ctx->oserr = errno;
+            break;
+        }
+        if (stream_feed(&s, buf, (size_t) got) != GOPTFOO_OK)
+            break;
+    }
+    ret = stream_end(&s);
+
+    mem_free(buf, GOPTFOO_CHUNK);
+    return ret;
+}
+
+static int list_file(struct goptfoo_ctx *ctx, struct list *l,
+                     const char *path)
+{
+    struct stat st;
+    void *map;
+    int fd, ret;
+
+    if (strncmp(path, "bin:", 4) == 0)
+        return list_binary(ctx, l, path + 4, NULL);
+    if (strcmp(path, "-") == 0)
+        return list_fd_chunks(ctx, l, STDIN_FILENO);
+
+    if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+        ret = fail(ctx, GOPTFOO_EFILE, NULL, NULL, NULL, 0);
+        ctx->oserr = errno;
+        if (fd >= 0)
+            close(fd);
+        return ret;
+    }
+    if (S_ISREG(st.st_mode) && st.st_size > 0
+        && (uintmax_t) st.st_size <= SIZE_MAX
+        && (map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+                       fd, 0)) != MAP_FAILED) {
+        close(fd);
+#ifdef MADV_SEQUENTIAL
+        madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+#endif
+        ret = list_bulk(ctx, l, map, (char *) map + st.st_size);
+        munmap(map, (size_t) st.st_size);
+        return ret;
+    }
+    ret = list_fd_chunks(ctx, l, fd);
+    close(fd);
+    return ret;
+}
+
+/* checks and cleanup once all the input has been parsed */
+static int list_done(struct goptfoo_ctx *ctx, struct list *l,
+                     const size_t list_min, size_t * numitems)
+{
+    int ret;
+
+    if (list_min > 0 && l->numi < list_min)
+        return fail(ctx, GOPTFOO_ETOOFEW, NULL, NULL, NULL, l->numi);
+    /* trim any excess, as streams and "1-2" could not be counted */
+    if (list_exact(ctx) && l->alloitems > (l->numi ? l->numi : 1)
+        && (ret = list_reserve(ctx, l, l->numi)) != GOPTFOO_OK)
+        return ret;
+    *numitems = l->numi;
+    return GOPTFOO_OK;
+}
+
+/* a view is filled by mapping a cache entry where there is one */
+static int list_read(struct goptfoo_ctx *ctx, struct list *l,
+                     const char *arg, const size_t list_min,
+                     size_t * numitems, struct goptfoo_view *view)
+{
+    uint64_t key[2];
+    size_t start;
+    int cache, ret;
+
+    if (!arg || *arg == '\0') {
+        ctx->code = GOPTFOO_OK;
+        return fail(ctx, GOPTFOO_ENOTSET, NULL, NULL, NULL, 0);
+    }
+    if ((ret = list_setup(ctx, l)) != GOPTFOO_OK)
+        return ret;
+    cache = ctx->cache_dir && !l->each && cache_key(ctx, l, arg, key) == 0;
+    if (cache && (ret = cache_load(ctx, l, key, view)) >= GOPTFOO_OK) {
+        if (ret != GOPTFOO_OK)
+            return ret;
+        return list_done(ctx, l, list_min, numitems);
+    }
+    start = l->numi;
+    if (*arg == '@') {
+        ret = list_file(ctx, l, arg + 1);
+    } else {
+        ret = list_bulk(ctx, l, arg, arg + strlen(arg));
+    }
+    if (ret != GOPTFOO_OK)
+        return ret;
+    if (cache)
+        cache_store(ctx, l, key, start);
+    return list_done(ctx, l, list_min, numitems);
+}
+
+static int list_load(struct goptfoo_ctx *ctx, struct list *l,
+                     const char *arg, const size_t list_min,
+                     size_t * numitems, struct goptfoo_view *view)
+{
+#ifdef GOPTFOO_STATS
+    const size_t start = l->numi;
+    STATS_START(GOPTFOO_STATS_LIST, t0);
+    int ret = list_read(ctx, l, arg, list_min, numitems, view);
+
+    STATS_END(GOPTFOO_STATS_LIST, t0, 0, l->numi - start);
+    return ret;
+#else
+    return list_read(ctx, l, arg, list_min, numitems, view);
+#endif
+}
+
+static int list_parse(struct goptfoo_ctx *ctx, struct list *l,
+                      const char *arg, const size_t list_min,
+                      size_t * numitems)
+{
+    return list_load(ctx, l, arg, list_min, numitems, NULL);
+}
+
+int goptfoo_parse_lods(struct goptfoo_ctx *ctx, const char *arg,
+                       const double min, const double max,
+                       double **items, size_t * numitems,
+                       const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_D;
+    l.size = sizeof(double);
+    l.min.d = min;
+    l.max.d = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+int goptfoo_parse_lolls(struct goptfoo_ctx *ctx, const char *arg,
+                        const long long min, const long long max,
+                        long long **items, size_t * numitems,
+                        const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_LL;
+    l.size = sizeof(long long);
+    l.min.ll = min;
+    l.max.ll = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+int goptfoo_parse_louls(struct goptfoo_ctx *ctx, const char *arg,
+                        const unsigned long min, const unsigned long max,
+                        unsigned long **items, size_t * numitems,
+                        const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_UL;
+    l.size = sizeof(unsigned long);
+    l.min.ul = min;
+    l.max.ul = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+/* the narrow types; see "narrow lists" above */
+
+int goptfoo_parse_lofs(struct goptfoo_ctx *ctx, const char *arg,
+                       const float min, const float max,
+                       float **items, size_t * numitems,
+                       const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_F;
+    l.size = sizeof(float);
+    l.min.d = min;
+    l.max.d = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+int goptfoo_parse_loi32s(struct goptfoo_ctx *ctx, const char *arg,
+                         const int32_t min, const int32_t max,
+                         int32_t **items, size_t * numitems,
+                         const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_I32;
+    l.size = sizeof(int32_t);
+    l.min.ll = min;
+    l.max.ll = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+int goptfoo_parse_loi16s(struct goptfoo_ctx *ctx, const char *arg,
+                         const int16_t min, const int16_t max,
+                         int16_t **items, size_t * numitems,
+                         const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_I16;
+    l.size = sizeof(int16_t);
+    l.min.ll = min;
+    l.max.ll = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+int goptfoo_parse_lou32s(struct goptfoo_ctx *ctx, const char *arg,
+                         const uint32_t min, const uint32_t max,
+                         uint32_t **items, size_t * numitems,
+                         const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_U32;
+    l.size = sizeof(uint32_t);
+    l.min.ul = min;
+    l.max.ul = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+int goptfoo_parse_lou8s(struct goptfoo_ctx *ctx, const char *arg,
+                        const uint8_t min, const uint8_t max,
+                        uint8_t **items, size_t * numitems,
+                        const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_U8;
+    l.size = sizeof(uint8_t);
+    l.min.ul = min;
+    l.max.ul = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+/* as the above but into a buffer of bufsize items supplied by the
+ * caller, which is never reallocated; there is no list_max as bufsize
+ * serves for that */
+
+int goptfoo_fill_lods(struct goptfoo_ctx *ctx, const char *arg,
+                      const double min, const double max, double *buf,
+                      const size_t bufsize, size_t * numitems,
+                      const size_t list_min)
+{
+    struct list l;
+
+    l.type = LIST_D;
+    l.size = sizeof(double);
+    l.min.d = min;
+    l.max.d = max;
+    l.items = (void **) &buf;
+    l.numi = *numitems;
+    l.alloitems = l.list_max = bufsize;
+    l.fixed = 1;
+    l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+int goptfoo_fill_lolls(struct goptfoo_ctx *ctx, const char *arg,
+                       const long long min, const long long max,
+                       long long *buf, const size_t bufsize,
+                       size_t * numitems, const size_t list_min)
+{
+    struct list l;
+
+    l.type = LIST_LL;
+    l.size = sizeof(long long);
+    l.min.ll = min;
+    l.max.ll = max;
+    l.items = (void **) &buf;
+    l.numi = *numitems;
+    l.alloitems = l.list_max = bufsize;
+    l.fixed = 1;
+    l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+int goptfoo_fill_louls(struct goptfoo_ctx *ctx, const char *arg,
+                       const unsigned long min, const unsigned long max,
+                       unsigned long *buf, const size_t bufsize,
+                       size_t * numitems, const size_t list_min)
+{
+    struct list l;
+
+    l.type = LIST_UL;
+    l.size = sizeof(unsigned long);
+    l.min.ul = min;
+    l.max.ul = max;
+    l.items = (void **) &buf;
+    l.numi = *numitems;
+    l.alloitems = l.list_max = bufsize;
+    l.fixed = 1;
+    l.each = 0;
+    return list_parse(ctx, &l, arg, list_min, numitems);
+}
+
+/* goptfoo_iter_* goptfoo_each_* ************************************** */
+
+static int iter_new(struct goptfoo_ctx *ctx, struct goptfoo_iter *it,
+                    int type, const char *arg)
+{
+    ctx->code = GOPTFOO_OK;
+    if (!arg || *arg == '\0')
+        return fail(ctx, GOPTFOO_ENOTSET, NULL, NULL, NULL, 0);
+    iter_setup(it, ctx, type, arg, arg, arg + strlen(arg), 0);
+    return GOPTFOO_OK;
+}
+
+int goptfoo_iter_lods(struct goptfoo_ctx *ctx, struct goptfoo_iter *it,
+                      const char *arg, const double min, const double max)
+{
+    it->min.d = min;
+    it->max.d = max;
+    return iter_new(ctx, it, LIST_D, arg);
+}
+
+int goptfoo_iter_lolls(struct goptfoo_ctx *ctx, struct goptfoo_iter *it,
+                       const char *arg, const long long min,
+                       const long long max)
+{
+    it->min.ll = min;
+    it->max.ll = max;
+    return iter_new(ctx, it, LIST_LL, arg);
+}
+
+int goptfoo_iter_louls(struct goptfoo_ctx *ctx, struct goptfoo_iter *it,
+                       const char *arg, const unsigned long min,
+                       const unsigned long max)
+{
+    it->min.ul = min;
+    it->max.ul = max;
+    return iter_new(ctx, it, LIST_UL, arg);
+}
+
+int goptfoo_iter_next(struct goptfoo_iter *it, void *value)
+{
+    union goptfoo_value v;
+    int ret;
+
+    /* ranges are handed out a value at a time */
+    if (it->ri < it->range.count) {
+        range_value(&it->range, it->ri++, &v);
+        ret = 1;
+    } else if ((ret = iter_step(it, &v)) == 2) {
+        range_value(&it->range, 0, &v);
+        it->ri = 1;
+        ret = 1;
+    }
+    if (ret > 0) {
+        switch (it->type) {
+        case LIST_D:
+            *(double *) value = v.d;
+            break;
+        case LIST_LL:
+            *(long long *) value = v.ll;
+            break;
+        default:
+            *(unsigned long *) value = v.ul;
+            break;
+        }
+    }
+    return ret;
+}
+
+/* the callback lists are lists with nowhere to put the items */
+static int list_each(struct goptfoo_ctx *ctx, struct list *l,
+                     const char *arg, void *data)
+{
+    void *none = NULL;
+    size_t numi;
+
+    l->items = &none;
+    l->numi = 0;
+    l->alloitems = l->list_max = SIZE_MAX;
+    l->fixed = l->each = 1;
+    l->data = data;
+    return list_parse(ctx, l, arg, 0, &numi);
+}
+
+int goptfoo_each_lods(struct goptfoo_ctx *ctx, const char *arg,
+                      const double min, const double max,
+                      int (*fn)(double value, void *data), void *data)
+{
+    struct list l;
+
+    l.type = LIST_D;
+    l.size = sizeof(double);
+    l.min.d = min;
+    l.max.d = max;
+    l.fn.d = fn;
+    return list_each(ctx, &l, arg, data);
+}
+
+int goptfoo_each_lolls(struct goptfoo_ctx *ctx, const char *arg,
+                       const long long min, const long long max,
+                       int (*fn)(long long value, void *data), void *data)
+{
+    struct list l;
+
+    l.type = LIST_LL;
+    l.size = sizeof(long long);
+    l.min.ll = min;
+    l.max.ll = max;
+    l.fn.ll = fn;
+    return list_each(ctx, &l, arg, data);
+}
+
+int goptfoo_each_louls(struct goptfoo_ctx *ctx, const char *arg,
+                       const unsigned long min, const unsigned long max,
+                       int (*fn)(unsigned long value, void *data),
+                       void *data)
+{
+    struct list l;
+
+    l.type = LIST_UL;
+    l.size = sizeof(unsigned long);
+    l.min.ul = min;
+    l.max.ul = max;
+    l.fn.ul = fn;
+    return list_each(ctx, &l, arg, data);
+}
+
+/* ranges ************************************************************* */
+
+static int range_parse(struct goptfoo_ctx *ctx, struct goptfoo_iter *it,
+                       int type, const char *arg,
+                       struct goptfoo_range *range)
+{
+    union goptfoo_value value;
+    int ret;
+
+    if ((ret = iter_new(ctx, it, type, arg)) != GOPTFOO_OK)
+        return ret;
+    it->flags |= GOPTFOO_RANGES;
+    if ((ret = iter_step(it, &value)) < 0)
+        return ctx->code;
+    if (ret == 0 || it->p != it->end)
+        return fail(ctx, GOPTFOO_EPARSE, arg, it->tok, it->end, 0);
+    if (ret == 2) {
+        *range = it->range;
+    } else {
+        range->type = type;
+        range->down = 0;
+        range->first = range->last = value;
+        range->step = 1;
+        range->count = 1;
+    }
+    return GOPTFOO_OK;
+}
+
+int goptfoo_parse_range_d(struct goptfoo_ctx *ctx, const char *arg,
+                          const double min, const double max,
+                          struct goptfoo_range *range)
+{
+    struct goptfoo_iter it;
+
+    it.min.d = min;
+    it.max.d = max;
+    return range_parse(ctx, &it, LIST_D, arg, range);
+}
+
+int goptfoo_parse_range_ll(struct goptfoo_ctx *ctx, const char *arg,
+                           const long long min, const long long max,
+                           struct goptfoo_range *range)
+{
+    struct goptfoo_iter it;
+
+    it.min.ll = min;
+    it.max.ll = max;
+    return range_parse(ctx, &it, LIST_LL, arg, range);
+}
+
+int goptfoo_parse_range_ul(struct goptfoo_ctx *ctx, const char *arg,
+                           const unsigned long min,
+                           const unsigned long max,
+                           struct goptfoo_range *range)
+{
+    struct goptfoo_iter it;
+
+    it.min.ul = min;
+    it.max.ul = max;
+    return range_parse(ctx, &it, LIST_UL, arg, range);
+}
+
+/* i must be below range->count */
+
+double goptfoo_range_d(const struct goptfoo_range *range, size_t i)
+{
+    union goptfoo_value value;
+
+    range_value(range, i, &value);
+    return value.d;
+}
+
+long long goptfoo_range_ll(const struct goptfoo_range *range, size_t i)
+{
+    union goptfoo_value value;
+
+    range_value(range, i, &value);
+    return value.ll;
+}
+
+unsigned long goptfoo_range_ul(const struct goptfoo_range *range, size_t i)
+{
+    union goptfoo_value value;
+
+    range_value(range, i, &value);
+    return value.ul;
+}
+
+/* goptfoo_stream_* *************************************************** */
+
+static struct goptfoo_stream *stream_new(struct goptfoo_ctx *ctx,
+                                         struct list *l,
+                                         size_t * numitems)
+{
+    struct goptfoo_stream *s;
+
+    if (list_setup(ctx, l) != GOPTFOO_OK)
+        return NULL;
+    if ((s = malloc(sizeof(*s))) == NULL) {
+        fail_nomem(ctx, 0);
+        return NULL;
+    }
+    s->list = *l;
+    s->numitems = numitems;
+    if (stream_init(ctx, s, &s->list) != GOPTFOO_OK) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+struct goptfoo_stream *goptfoo_stream_lods(struct goptfoo_ctx *ctx,
+                                           const double min,
+                                           const double max,
+                                           double **items,
+                                           size_t * numitems,
+                                           size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_D;
+    l.size = sizeof(double);
+    l.min.d = min;
+    l.max.d = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return stream_new(ctx, &l, numitems);
+}
+
+struct goptfoo_stream *goptfoo_stream_lolls(struct goptfoo_ctx *ctx,
+                                            const long long min,
+                                            const long long max,
+                                            long long **items,
+                                            size_t * numitems,
+                                            size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_LL;
+    l.size = sizeof(long long);
+    l.min.ll = min;
+    l.max.ll = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return stream_new(ctx, &l, numitems);
+}
+
+struct goptfoo_stream *goptfoo_stream_louls(struct goptfoo_ctx *ctx,
+                                            const unsigned long min,
+                                            const unsigned long max,
+                                            unsigned long **items,
+                                            size_t * numitems,
+                                            size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_UL;
+    l.size = sizeof(unsigned long);
+    l.min.ul = min;
+    l.max.ul = max;
+    l.items = (void **) items;
+    l.numi = l.alloitems = *numitems;
+    l.list_max = list_max;
+    l.fixed = l.each = 0;
+    return stream_new(ctx, &l, numitems);
+}
+
+/* once an error has happened further input is ignored, and the error
+ * is returned again */
+int goptfoo_stream_feed(struct goptfoo_stream *stream, const char *buf,
+                        const size_t len)
+{
+    return stream_feed(stream, buf, len);
+}
+
+int goptfoo_stream_finish(struct goptfoo_stream *stream,
+                          const size_t list_min)
+{
+    int ret;
+
+    if ((ret = stream_end(stream)) == GOPTFOO_OK)
+        ret = list_done(stream->ctx, stream->l, list_min,
+                        stream->numitems);
+    free(stream);
+    return ret;
+}
+
+/* goptfoo_view_* ***************************************************** */
+
+/* views are released by goptfoo_view_free, which has no context, so
+ * their items always come from realloc(3) */
+static int view_parse(struct goptfoo_ctx *ctx, struct list *l,
+                      const char *arg, const size_t list_min,
+                      struct goptfoo_view *view)
+{
+    const struct goptfoo_alloc *alloc = ctx->alloc;
+    int ret;
+
+    view->items = view->base = NULL;
+    view->numitems = view->maplen = view->bytes = 0;
+    ctx->alloc = NULL;
+    l->items = &view->base;
+    l->numi = l->alloitems = 0;
+    l->fixed = l->each = 0;
+    if (arg && strncmp(arg, "@bin:", 5) == 0) {
+        if ((ret = list_setup(ctx, l)) == GOPTFOO_OK
+            && (ret = list_binary(ctx, l, arg + 5, view)) == GOPTFOO_OK)
+            ret = list_done(ctx, l, list_min, &view->numitems);
+    } else {
+        ret = list_load(ctx, l, arg, list_min, &view->numitems, view);
+    }
+    ctx->alloc = alloc;
+    if (view->maplen == 0)
+        view->bytes = l->alloitems * l->size;
+    if (ret != GOPTFOO_OK) {
+        goptfoo_view_free(view);
+        return ret;
+    }
+    /* cache entries have their items after a header */
+    if (!view->items)
+        view->items = view->base;
+    return GOPTFOO_OK;
+}
+
+int goptfoo_view_lods(struct goptfoo_ctx *ctx, const char *arg,
+                      const double min, const double max,
+                      struct goptfoo_view *view, const size_t list_min,
+                      size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_D;
+    l.size = sizeof(double);
+    l.min.d = min;
+    l.max.d = max;
+    l.list_max = list_max;
+    return view_parse(ctx, &l, arg, list_min, view);
+}
+
+int goptfoo_view_lolls(struct goptfoo_ctx *ctx, const char *arg,
+                       const long long min, const long long max,
+                       struct goptfoo_view *view, const size_t list_min,
+                       size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_LL;
+    l.size = sizeof(long long);
+    l.min.ll = min;
+    l.max.ll = max;
+    l.list_max = list_max;
+    return view_parse(ctx, &l, arg, list_min, view);
+}
+
+int goptfoo_view_louls(struct goptfoo_ctx *ctx, const char *arg,
+                       const unsigned long min, const unsigned long max,
+                       struct goptfoo_view *view, const size_t list_min,
+                       size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_UL;
+    l.size = sizeof(unsigned long);
+    l.min.ul = min;
+    l.max.ul = max;
+    l.list_max = list_max;
+    return view_parse(ctx, &l, arg, list_min, view);
+}
+
+void goptfoo_view_free(struct goptfoo_view *view)
+{
+    if (view->maplen > 0)
+        munmap(view->base, view->maplen);
+    else
+        items_free(NULL, view->base, view->bytes);
+    view->items = view->base = NULL;
+    view->numitems = view->maplen = view->bytes = 0;
+}
+
+/* goptfoo_check_* **************************************************** */
+
+/* the bulk bounds check on its own, for values the caller already has;
+ * NaN is an error here */
+static int check_items(struct goptfoo_ctx *ctx, const struct list *l,
+                       const void *items, const size_t numitems)
+{
+    size_t bad;
+    int code = GOPTFOO_OK;
+
+    ctx->code = GOPTFOO_OK;
+    if ((bad = list_check(l, items, numitems, 0, &code)) < numitems)
+        return fail(ctx, code, NULL, NULL, NULL, bad);
+    return GOPTFOO_OK;
+}
+
+int goptfoo_check_lods(struct goptfoo_ctx *ctx, const double *items,
+                       const size_t numitems, const double min,
+                       const double max)
+{
+    struct list l;
+
+    l.type = LIST_D;
+    l.min.d = min;
+    l.max.d = max;
+    return check_items(ctx, &l, items, numitems);
+}
+
+int goptfoo_check_lolls(struct goptfoo_ctx *ctx, const long long *items,
+                        const size_t numitems, const long long min,
+                        const long long max)
+{
+    struct list l;
+
+    l.type = LIST_LL;
+    l.min.ll = min;
+    l.max.ll = max;
+    return check_items(ctx, &l, items, numitems);
+}
+
+int goptfoo_check_louls(struct goptfoo_ctx *ctx, const unsigned long *items,
+                        const size_t numitems, const unsigned long min,
+                        const unsigned long max)
+{
+    struct list l;
+
+    l.type = LIST_UL;
+    l.min.ul = min;
+    l.max.ul = max;
+    return check_items(ctx, &l, items, numitems);
+}
+
+int goptfoo_check_lofs(struct goptfoo_ctx *ctx, const float *items,
+                       const size_t numitems, const float min,
+                       const float max)
+{
+    struct list l;
+
+    l.type = LIST_F;
+    l.min.d = min;
+    l.max.d = max;
+    return check_items(ctx, &l, items, numitems);
+}
+
+int goptfoo_check_loi32s(struct goptfoo_ctx *ctx, const int32_t *items,
+                         const size_t numitems, const int32_t min,
+                         const int32_t max)
+{
+    struct list l;
+
+    l.type = LIST_I32;
+    l.min.ll = min;
+    l.max.ll = max;
+    return check_items(ctx, &l, items, numitems);
+}
+
+int goptfoo_check_loi16s(struct goptfoo_ctx *ctx, const int16_t *items,
+                         const size_t numitems, const int16_t min,
+                         const int16_t max)
+{
+    struct list l;
+
+    l.type = LIST_I16;
+    l.min.ll = min;
+    l.max.ll = max;
+    return check_items(ctx, &l, items, numitems);
+}
+
+int goptfoo_check_lou32s(struct goptfoo_ctx *ctx, const uint32_t *items,
+                         const size_t numitems, const uint32_t min,
+                         const uint32_t max)
+{
+    struct list l;
+
+    l.type = LIST_U32;
+    l.min.ul = min;
+    l.max.ul = max;
+    return check_items(ctx, &l, items, numitems);
+}
+
+int goptfoo_check_lou8s(struct goptfoo_ctx *ctx, const uint8_t *items,
+                        const size_t numitems, const uint8_t min,
+                        const uint8_t max)
+{
+    struct list l;
+
+    l.type = LIST_U8;
+    l.min.ul = min;
+    l.max.ul = max;
+    return check_items(ctx, &l, items, numitems);
+}
+
+/* goptfoo_set_* ****************************************************** */
+
+/* after Roaring bitmaps: a value goes in the chunk for its upper bits
+ * (the key), and the chunk holds the lower 16 bits of its values either
+ * as a sorted array of up to GOPTFOO_SET_ARRAY of them, or past that as
+ * a bitmap of all 65536, which is then no larger than the array was.
+ * as values are never removed, a chunk is a bitmap exactly when it holds
+ * more than GOPTFOO_SET_ARRAY values. the chunks are sorted by key.
+ * a chunk for only a few values costs more than the values would as
+ * unsigned longs, so sets start out as a plain sorted array, and move to
+ * chunks only when that would take less memory. either way an open
+ * addressed hash of the keys leads to the chunk, or to the first value
+ * of the array with that key, so that membership is a probe of the hash
+ * and then at most a search within a container of 65536; should there
+ * be no memory for the hash the chunks or values are searched instead */
+
+#define GOPTFOO_SET_ARRAY 4096
+#define GOPTFOO_SET_WORDS (65536 / 64)
+#define GOPTFOO_SET_BATCH 65536
+
+struct goptfoo_set_chunk {
+    unsigned long key;
+    uint32_t count;
+    uint32_t alloc;             /* array capacity */
+    union {
+        uint16_t *array;
+        uint64_t *bits;
+    } u;
+};
+
+static inline unsigned int set_ctz(uint64_t word)
+{
+#ifdef __GNUC__
+    return (unsigned int) __builtin_ctzll(word);
+#else
+    unsigned int n = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* the bytes of a chunk's array or bitmap */
+static size_t chunk_bytes(const struct goptfoo_set_chunk *c)
+{
+    return c->count > GOPTFOO_SET_ARRAY ? GOPTFOO_SET_WORDS * sizeof(uint64_t)
+        : c->alloc * sizeof(uint16_t);
+}
+
+void goptfoo_set_init(struct goptfoo_set *set)
+{
+    memset(set, 0, sizeof(*set));
+}
+
+/* index of the first chunk with a key at or above key */
+static size_t set_find(const struct goptfoo_set *set, const unsigned long key)
+{
+    size_t lo = 0, hi = set->numchunks, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (set->chunks[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* index of the first value at or above value in the sorted array */
+static size_t set_lower(const unsigned long *vals, const size_t n,
+                        const unsigned long value)
+{
+    size_t lo = 0, hi = n, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (vals[mid] < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* the key of chunk or sorted value i */
+static inline unsigned long set_key(const struct goptfoo_set *set,
+                                    const size_t i)
+{
+    return set->chunks ? set->chunks[i].key : set->values[i] >> 16;
+}
+
+/* the slot for key in the index; empty should the key not be there */
+static size_t set_slot(const struct goptfoo_set *set,
+                       const unsigned long key)
+{
+    size_t h = (size_t) cache_fmix(key) & set->indexmask;
+    uint32_t s;
+
+    while ((s = set->index[h]) != 0) {
+        if (set_key(set, s - 1) == key)
+            break;
+        h = (h + 1) & set->indexmask;
+    }
+    return h;
+}
+
+/* (re)build the index, at most three quarters full. this is only ever
+ * an aid to lookups, so without the memory for it the set goes without */
+static void set_index(struct goptfoo_set *set)
+{
+    size_t i, n, keys = 0, slots = 8;
+    int ret;
+
+    mem_free(set->index, (set->indexmask + 1) * sizeof(uint32_t));
+    set->index = NULL;
+    set->indexmask = set->indexkeys = 0;
+
+    /* positions are kept below INT32_MAX so that set_index_insert may
+     * take the sign of a difference of two of them */
+    n = set->chunks ? set->numchunks : set->count;
+    if (n == 0 || n >= INT32_MAX)
+        return;
+    for (i = 0; i < n; i++)
+        if (i == 0 || set_key(set, i) != set_key(set, i - 1))
+            keys++;
+    while (slots - slots / 4 < keys) {
+        if (slots > SIZE_MAX / 2 / sizeof(uint32_t))
+            return;
+        slots <<= 1;
+    }
+    if ((set->index = mem_zero(slots, sizeof(uint32_t), &ret)) == NULL)
+        return;
+    set->indexmask = slots - 1;
+    set->indexkeys = keys;
+    for (i = 0; i < n; i++)
+        if (i == 0 || set_key(set, i) != set_key(set, i - 1))
+            set->index[set_slot(set, set_key(set, i))] = (uint32_t) i + 1;
+}
+
+/* a value has gone into the sorted array at i, moving those after it
+ * up one */
+static void set_index_insert(struct goptfoo_set *set, const size_t i)
+{
+    uint32_t *index = set->index;
+    const int32_t at = (int32_t) i;
+    size_t h, j, k, slots = set->indexmask + 1;
+
+    if (!set->index || set->count >= INT32_MAX
+        || set->indexkeys + 1 > slots - slots / 4) {
+        set_index(set);
+        return;
+    }
+    /* one more for each slot after at (and none for the empty slots),
+     * from the sign of at less the slot. there are a power of two slots,
+     * at least eight, so a constant stride of them lets the compiler
+     * vectorize this as it does the bounds checks */
+    for (j = 0; j < slots; j += 8)
+        for (k = 0; k < 8; k++)
+            index[j + k] += (uint32_t) (at - (int32_t) index[j + k]) >> 31;
+    /* the key either is new, or its first value may now be this one */
+    h = set_slot(set, set->values[i] >> 16);
+    if (set->index[h] == 0)
+        set->indexkeys++;
+    if (set->index[h] == 0 || set->index[h] > i + 1)
+        set->index[h] = (uint32_t) i + 1;
+}
+
+/* add n sorted distinct lower halves to the chunk; the result goes to a
+ * bitmap should it no longer fit an array */
+static int chunk_add(struct goptfoo_set *set, struct goptfoo_set_chunk *c,
+                     const uint16_t * lows, const size_t n)
+{
+    uint16_t *merged;
+    uint64_t *bits, bit;
+    size_t i, j, k, bytes = (c->count + n) * sizeof(uint16_t);
+    int ret;
+
+    if (c->count > GOPTFOO_SET_ARRAY) {
+        for (i = 0; i < n; i++) {
+            bit = (uint64_t) 1 << (lows[i] & 63);
+            if (!(c->u.bits[lows[i] >> 6] & bit)) {
+                c->u.bits[lows[i] >> 6] |= bit;
+                c->count++;
+                set->count++;
+            }
+        }
+        return GOPTFOO_OK;
+    }
+
+    if ((merged = mem_resize(NULL, 0, bytes, &ret)) == NULL)
+        return ret;
+    for (i = j = k = 0; i < c->count || j < n;) {
+        if (j == n || (i < c->count && c->u.array[i] < lows[j]))
+            merged[k++] = c->u.array[i++];
+        else if (i == c->count || lows[j] < c->u.array[i])
+            merged[k++] = lows[j++];
+        else {
+            merged[k++] = c->u.array[i++];
+            j++;
+        }
+    }
+    set->count += k - c->count;
+
+    if (k > GOPTFOO_SET_ARRAY) {
+        if ((bits = mem_zero(GOPTFOO_SET_WORDS, sizeof(uint64_t), &ret))
+            == NULL) {
+            set->count -= k - c->count;
+            mem_free(merged, bytes);
+            return ret;
+        }
+        for (i = 0; i < k; i++)
+            bits[merged[i] >> 6] |= (uint64_t) 1 << (merged[i] & 63);
+        mem_free(merged, bytes);
+        mem_free(c->u.array, chunk_bytes(c));
+        c->u.bits = bits;
+        c->alloc = 0;
+    } else {
+        mem_free(c->u.array, chunk_bytes(c));
+        c->u.array = merged;
+        c->alloc = (uint32_t) (c->count + n);
+    }
+    c->count = (uint32_t) k;
+    return GOPTFOO_OK;
+}
+
+/* make room for m more chunks */
+static int set_grow(struct goptfoo_set *set, const size_t m)
+{
+    struct goptfoo_set_chunk *p;
+    size_t want;
+    int ret;
+
+    if (set->numchunks + m <= set->allochunks)
+        return GOPTFOO_OK;
+    want = set->allochunks ? set->allochunks << 1 : 8;
+    if (want < set->numchunks + m)
+        want = set->numchunks + m;
+    if ((p = mem_resize(set->chunks, set->allochunks * sizeof(*p),
+                        want * sizeof(*p), &ret)) == NULL)
+        return ret;
+    set->chunks = p;
+    set->allochunks = want;
+    return GOPTFOO_OK;
+}
+
+/* merge n sorted distinct values into the chunks. new chunks are first
+ * merged in with the old from the back, so that a batch costs one pass
+ * over the chunks however many new keys it brings */
+static int chunks_merge(struct goptfoo_set *set, const unsigned long *vals,
+                        const size_t n, uint16_t * lows)
+{
+    struct goptfoo_set_chunk *c;
+    size_t i, j, k, m = 0, old = set->numchunks;
+    unsigned long key;
+    int ret;
+
+    for (i = 0, j = 0; i < n;) {
+        key = vals[i] >> 16;
+        while (j < old && set->chunks[j].key < key)
+            j++;
+        if (j == old || set->chunks[j].key != key)
+            m++;
+        while (i < n && vals[i] >> 16 == key)
+            i++;
+    }
+    if (m > 0) {
+        if ((ret = set_grow(set, m)) != GOPTFOO_OK)
+            return ret;
+        i = n;
+        j = old;
+        k = old + m;
+        while (k > j) {
+            key = vals[i - 1] >> 16;
+            if (j > 0 && set->chunks[j - 1].key >= key) {
+                if (set->chunks[j - 1].key == key)
+                    while (i > 0 && vals[i - 1] >> 16 == key)
+                        i--;
+                set->chunks[--k] = set->chunks[--j];
+            } else {
+                c = &set->chunks[--k];
+                c->key = key;
+                c->count = c->alloc = 0;
+                c->u.array = NULL;
+                while (i > 0 && vals[i - 1] >> 16 == key)
+                    i--;
+            }
+        }
+        set->numchunks = old + m;
+        set_index(set);
+    }
+
+    for (i = 0, j = 0; i < n;) {
+        key = vals[i] >> 16;
+        while (set->chunks[j].key < key)
+            j++;
+        for (k = 0; i < n && vals[i] >> 16 == key; i++)
+            lows[k++] = (uint16_t) vals[i];
+        if ((ret = chunk_add(set, &set->chunks[j], lows, k)) != GOPTFOO_OK)
+            return ret;
+    }
+    return GOPTFOO_OK;
+}
+
+/* whether the sorted values would take less memory as chunks; each
+ * chunk costs its header and the overhead of an allocation, and each
+ * value two bytes */
+static int set_dense(const unsigned long *vals, const size_t n)
+{
+    size_t i, keys = 0;
+
+    for (i = 0; i < n; i++)
+        if (i == 0 || vals[i] >> 16 != vals[i - 1] >> 16)
+            keys++;
+    return keys * (sizeof(struct goptfoo_set_chunk) + 16)
+        + n * sizeof(uint16_t) < n * sizeof(unsigned long);
+}
+
+static void set_chunks_free(struct goptfoo_set *set)
+{
+    size_t i;
+
+    for (i = 0; i < set->numchunks; i++)
+        mem_free(set->chunks[i].u.array, chunk_bytes(&set->chunks[i]));
+    mem_free(set->chunks, set->allochunks * sizeof(struct goptfoo_set_chunk));
+    set->chunks = NULL;
+    set->numchunks = set->allochunks = 0;
+}
+
+/* move the sorted array over to chunks; should memory run out part way
+ * the set is left as the array, which is still whole */
+static void set_chunk(struct goptfoo_set *set, uint16_t * lows)
+{
+    const size_t count = set->count;
+    uint16_t *buf = lows;
+    int ret;
+
+    if (!buf && (buf = mem_resize(NULL, 0, 65536 * sizeof(uint16_t), &ret))
+        == NULL)
+        return;
+    set->count = 0;
+    if (chunks_merge(set, set->values, count, buf) == GOPTFOO_OK) {
+        mem_free(set->values, set->allocvalues * sizeof(unsigned long));
+        set->values = NULL;
+        set->allocvalues = 0;
+    } else {
+        set_chunks_free(set);
+        set->count = count;
+        set_index(set);
+    }
+    if (!lows)
+        mem_free(buf, 65536 * sizeof(uint16_t));
+}
+
+/* merge n sorted distinct values into the set, moving it over to chunks
+ * should it have become dense enough. lows has room for n lower halves,
+ * and so for a whole chunk of them only once n is that many */
+static int set_merge(struct goptfoo_set *set, const unsigned long *vals,
+                     const size_t n, uint16_t * lows)
+{
+    unsigned long *merged;
+    size_t i, j, k;
+    int ret;
+
+    if (set->chunks)
+        return chunks_merge(set, vals, n, lows);
+
+    if ((merged = mem_resize(NULL, 0, (set->count + n)
+                             * sizeof(unsigned long), &ret)) == NULL)
+        return ret;
+    for (i = j = k = 0; i < set->count || j < n;) {
+        if (j == n || (i < set->count && set->values[i] < vals[j]))
+            merged[k++] = set->values[i++];
+        else if (i == set->count || vals[j] < set->values[i])
+            merged[k++] = vals[j++];
+        else {
+            merged[k++] = set->values[i++];
+            j++;
+        }
+    }
+    mem_free(set->values, set->allocvalues * sizeof(unsigned long));
+    set->values = merged;
+    set->allocvalues = set->count + n;
+    set->count = k;
+
+    if (k > GOPTFOO_SET_ARRAY && set_dense(merged, k))
+        set_chunk(set, n >= 65536 ? lows : NULL);
+    else
+        set_index(set);
+    return GOPTFOO_OK;
+}
+
+/* LSD radix sort a byte at a time, skipping the bytes that are the same
+ * in every value (the upper ones, for most ID lists), then drop the
+ * duplicates. already sorted input is left as is */
+static size_t set_sort(unsigned long *vals, unsigned long *tmp, size_t n)
+{
+    size_t count[sizeof(unsigned long)][256], i, j, sum, next;
+    unsigned long *src = vals, *dst = tmp, *swap;
+    unsigned int b;
+
+    for (i = 1; i < n && vals[i - 1] <= vals[i]; i++) ;
+    if (i < n) {
+        memset(count, 0, sizeof(count));
+        for (i = 0; i < n; i++)
+            for (b = 0; b < sizeof(unsigned long); b++)
+                count[b][(vals[i] >> (b * 8)) & 0xFF]++;
+        for (b = 0; b < sizeof(unsigned long); b++) {
+            if (count[b][(vals[0] >> (b * 8)) & 0xFF] == n)
+                continue;
+            for (j = 0, sum = 0; j < 256; j++) {
+                next = sum + count[b][j];
+                count[b][j] = sum;
+                sum = next;
+            }
+            for (i = 0; i < n; i++)
+                dst[count[b][(src[i] >> (b * 8)) & 0xFF]++] = src[i];
+            swap = src;
+            src = dst;
+            dst = swap;
+        }
+        if (src != vals)
+            memcpy(vals, src, n * sizeof(unsigned long));
+    }
+    for (i = j = 1; i < n; i++)
+        if (vals[i] != vals[j - 1])
+            vals[j++] = vals[i];
+    return n ? j : 0;
+}
+
+/* values from the list are gathered into a batch that is sorted and
+ * merged in when full. the batch starts small and doubles up to
+ * GOPTFOO_SET_BATCH, so that a short list does not take the memory of a
+ * whole batch from the budget */
+#define GOPTFOO_SET_FIRST 256
+
+#define SET_BATCH_BYTES(cap)                                            \
+    ((cap) * (2 * sizeof(unsigned long) + sizeof(uint16_t)))
+
+struct set_batch {
+    struct goptfoo_set *set;
+    unsigned long *vals;        /* then the sort buffer, then lows */
+    uint16_t *lows;
+    size_t n;
+    size_t cap;
+    size_t list_max;
+    int ret;
+};
+
+/* grow the batch to cap values; only the values need to be kept */
+static int set_room(struct set_batch *b, const size_t cap)
+{
+    unsigned long *vals;
+
+    if ((vals = mem_resize(b->vals, SET_BATCH_BYTES(b->cap),
+                           SET_BATCH_BYTES(cap), &b->ret)) == NULL)
+        return -1;
+    b->vals = vals;
+    b->lows = (uint16_t *) (vals + 2 * cap);
+    b->cap = cap;
+    return 0;
+}
+
+static int set_flush(struct set_batch *b)
+{
+    size_t n = set_sort(b->vals, b->vals + b->cap, b->n);
+    size_t i, room = 0, fresh = 0;
+
+    b->n = 0;
+    /* near list_max, count what the batch would add before adding any
+     * of it, so that the set never holds more than list_max values */
+    if (b->set->count < b->list_max)
+        room = b->list_max - b->set->count;
+    if (n > room) {
+        for (i = 0; i < n && fresh <= room; i++)
+            fresh += !goptfoo_set_has(b->set, b->vals[i]);
+        if (fresh > room) {
+            b->ret = GOPTFOO_ETOOMANY;
+            return -1;
+        }
+    }
+    if ((b->ret = set_merge(b->set, b->vals, n, b->lows)) != GOPTFOO_OK)
+        return -1;
+    return 0;
+}
+
+static int set_value(unsigned long value, void *data)
+{
+    struct set_batch *b = data;
+
+    b->vals[b->n++] = value;
+    if (b->n < b->cap)
+        return 0;
+    if (b->cap < GOPTFOO_SET_BATCH)
+        return set_room(b, b->cap * 2);
+    return set_flush(b);
+}
+
+int goptfoo_parse_set(struct goptfoo_ctx *ctx, const char *arg,
+                      const unsigned long min, const unsigned long max,
+                      struct goptfoo_set *set, const size_t list_min,
+                      size_t list_max)
+{
+    struct set_batch b;
+    int ret;
+
+    b.set = set;
+    b.vals = NULL;
+    b.n = b.cap = 0;
+    b.list_max = list_max ? list_max : SIZE_MAX;
+    b.ret = GOPTFOO_OK;
+    if (set_room(&b, GOPTFOO_SET_FIRST) < 0) {
+        ctx->code = GOPTFOO_OK;
+        return fail_alloc(ctx, b.ret, 0);
+    }
+    ret = goptfoo_each_louls(ctx, arg, min, max, set_value, &b);
+    if (ret == GOPTFOO_OK && b.n > 0 && set_flush(&b) < 0)
+        ret = GOPTFOO_ESTOPPED;
+    mem_free(b.vals, SET_BATCH_BYTES(b.cap));
+
+    /* a batch that could not be grown or merged stopped the list */
+    if (ret == GOPTFOO_ESTOPPED)
+        return fail_alloc(ctx, b.ret, set->count);
+    if (ret != GOPTFOO_OK)
+        return ret;
+    if (set->count < list_min)
+        return fail(ctx, GOPTFOO_ETOOFEW, NULL, NULL, NULL, set->count);
+    return GOPTFOO_OK;
+}
+
+int goptfoo_set_add(struct goptfoo_ctx *ctx, struct goptfoo_set *set,
+                    const unsigned long value)
+{
+    uint16_t low = (uint16_t) value;
+    unsigned long *values;
+    size_t i, alloc;
+    int ret;
+
+    ctx->code = GOPTFOO_OK;
+    if (set->chunks) {
+        if ((ret = chunks_merge(set, &value, 1, &low)) != GOPTFOO_OK)
+            return fail_alloc(ctx, ret, set->count);
+        return GOPTFOO_OK;
+    }
+
+    /* one at a time into the array goes in place, with room to spare */
+    i = set_lower(set->values, set->count, value);
+    if (i < set->count && set->values[i] == value)
+        return GOPTFOO_OK;
+    if (set->count == set->allocvalues) {
+        alloc = set->allocvalues ? set->allocvalues * 2 : 16;
+        if ((values = mem_resize(set->values, set->allocvalues
+                                 * sizeof(unsigned long),
+                                 alloc * sizeof(unsigned long), &ret))
+            == NULL)
+            return fail_alloc(ctx, ret, set->count);
+        set->values = values;
+        set->allocvalues = alloc;
+    }
+    memmove(set->values + i + 1, set->values + i,
+            (set->count - i) * sizeof(unsigned long));
+    set->values[i] = value;
+    set->count++;
+    /* the density is only worth a look now and then */
+    if (set->count > GOPTFOO_SET_ARRAY && !(set->count & (set->count - 1))
+        && set_dense(set->values, set->count))
+        set_chunk(set, NULL);
+    else
+        set_index_insert(set, i);
+    return GOPTFOO_OK;
+}
+
+int goptfoo_set_has(const struct goptfoo_set *set, const unsigned long value)
+{
+    const struct goptfoo_set_chunk *c;
+    const unsigned long key = value >> 16;
+    const uint16_t low = (uint16_t) value;
+    const unsigned long *vals = set->values;
+    size_t i, n = set->count, lo, hi, mid;
+    uint32_t s;
+
+    if (set->index) {
+        if ((s = set->index[set_slot(set, key)]) == 0)
+            return 0;
+        i = s - 1;
+        if (!set->chunks) {
+            /* the values with one key are a run of at most 65536 */
+            vals += i;
+            if ((n -= i) > 65536)
+                n = 65536;
+        }
+    } else if (set->chunks) {
+        i = set_find(set, key);
+        if (i == set->numchunks || set->chunks[i].key != key)
+            return 0;
+    }
+    if (!set->chunks) {
+        i = set_lower(vals, n, value);
+        return i < n && vals[i] == value;
+    }
+    c = &set->chunks[i];
+    if (c->count > GOPTFOO_SET_ARRAY)
+        return (c->u.bits[low >> 6] >> (low & 63)) & 1;
+    for (lo = 0, hi = c->count; lo < hi;) {
+        mid = lo + (hi - lo) / 2;
+        if (c->u.array[mid] < low)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < c->count && c->u.array[lo] == low;
+}
+
+size_t goptfoo_set_count(const struct goptfoo_set *set)
+{
+    return set->count;
+}
+
+/* the memory the set uses, for those wondering */
+size_t goptfoo_set_bytes(const struct goptfoo_set *set)
+{
+    size_t i, n = set->allochunks * sizeof(struct goptfoo_set_chunk)
+        + set->allocvalues * sizeof(unsigned long);
+
+    if (set->index)
+        n += (set->indexmask + 1) * sizeof(uint32_t);
+    for (i = 0; i < set->numchunks; i++)
+        n += chunk_bytes(&set->chunks[i]);
+    return n;
+}
+
+void goptfoo_set_iter(const struct goptfoo_set *set,
+                      struct goptfoo_set_iter *it)
+{
+    it->set = set;
+    it->chunk = it->pos = 0;
+}
+
+/* 1 and the next value in ascending order, or 0 at the end */
+int goptfoo_set_next(struct goptfoo_set_iter *it, unsigned long *value)
+{
+    const struct goptfoo_set_chunk *c;
+    uint64_t word;
+    size_t w;
+
+    if (!it->set->chunks) {
+        if (it->pos < it->set->count) {
+            *value = it->set->values[it->pos++];
+            return 1;
+        }
+        return 0;
+    }
+    for (; it->chunk < it->set->numchunks; it->chunk++, it->pos = 0) {
+        c = &it->set->chunks[it->chunk];
+        if (c->count <= GOPTFOO_SET_ARRAY) {
+            if (it->pos < c->count) {
+                *value = c->key << 16 | c->u.array[it->pos++];
+                return 1;
+            }
+            continue;
+        }
+        for (w = it->pos >> 6; w < GOPTFOO_SET_WORDS; w++) {
+            word = c->u.bits[w];
+            if (w == it->pos >> 6)
+                word &= ~(uint64_t) 0 << (it->pos & 63);
+            if (word) {
+                it->pos = w * 64 + set_ctz(word);
+                *value = c->key << 16 | it->pos;
+                it->pos++;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+void goptfoo_set_free(struct goptfoo_set *set)
+{
+    set_chunks_free(set);
+    mem_free(set->values, set->allocvalues * sizeof(unsigned long));
+    mem_free(set->index, (set->indexmask + 1) * sizeof(uint32_t));
+    goptfoo_set_init(set);
+}
+
+/* goptfoo_matrix_* *************************************************** */
+
+/* a matrix is a list with runs of semicolons in it; each stretch between
+ * them is parsed as a list, and a run of k semicolons ends the current
+ * block of each of the k innermost dimensions. every block of a given
+ * dimension must hold as many of the next one in as the first did. the
+ * values go into a growing list as usual, and are then copied into the
+ * aligned buffer, which costs little next to the parsing */
+
+/* the text of a matrix or key=value list: the argument itself, or the
+ * contents of an @path (mapped where possible) or @- for standard input.
+ * what is read is left in a buffer of exactly len bytes, which
+ * arg_text_free gives back */
+static int arg_text(struct goptfoo_ctx *ctx, const char *arg,
+                    const char **text, size_t * len, void **buf,
+                    size_t * maplen)
+{
+    const char *path = arg + 1;
+    struct stat st;
+    size_t have = 0, alloc = 0, want;
+    ssize_t got;
+    char *p;
+    void *map;
+    int fd, ret;
+
+    *buf = NULL;
+    *maplen = 0;
+    if (*arg != '@') {
+        *text = arg;
+        *len = strlen(arg);
+        return GOPTFOO_OK;
+    }
+    if (strncmp(path, "bin:", 4) == 0)
+        return fail(ctx, GOPTFOO_EFORMAT, arg, arg, arg + 5, 0);
+
+    if (strcmp(path, "-") == 0) {
+        fd = STDIN_FILENO;
+    } else if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+        ret = fail(ctx, GOPTFOO_EFILE, NULL, NULL, NULL, 0);
+        ctx->oserr = errno;
+        if (fd >= 0)
+            close(fd);
+        return ret;
+    } else if (S_ISREG(st.st_mode) && st.st_size > 0
+               && (uintmax_t) st.st_size <= SIZE_MAX
+               && (map = mmap(NULL, (size_t) st.st_size, PROT_READ,
+                              MAP_PRIVATE, fd, 0)) != MAP_FAILED) {
+        close(fd);
+        *text = *buf = map;
+        *len = *maplen = (size_t) st.st_size;
+        return GOPTFOO_OK;
+    }
+
+    ret = GOPTFOO_OK;
+    for (;;) {
+        if (have == alloc) {
+            want = alloc ? alloc << 1 : GOPTFOO_CHUNK;
+            if ((p = mem_resize(*buf, alloc, want, &ret)) == NULL) {
+                ret = fail_alloc(ctx, ret, 0);
+                break;
+            }
+            *buf = p;
+            alloc = want;
+        }
+        if ((got = read(fd, (char *) *buf + have, alloc - have)) == 0)
+            break;
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            ret = fail(ctx, GOPTFOO_EFILE, NULL, NULL, NULL, 0);
+            ctx->oserr = errno;
+            break;
+        }
+        have += (size_t) got;
+    }
+    if (fd != STDIN_FILENO)
+        close(fd);
+    if (ret == GOPTFOO_OK && have > 0 && have < alloc) {
+        if ((p = mem_resize(*buf, alloc, have, &ret)) == NULL) {
+            ret = fail_alloc(ctx, ret, 0);
+        } else {
+            *buf = p;
+            alloc = have;
+        }
+    }
+    if (ret != GOPTFOO_OK || have == 0) {
+        mem_free(*buf, alloc);
+        *buf = NULL;
+        if (ret != GOPTFOO_OK)
+            return ret;
+    }
+    *text = *buf ? *buf : "";
+    *len = have;
+    return GOPTFOO_OK;
+}
+
+static void arg_text_free(void *buf, const size_t len, const size_t maplen)
+{
+    if (maplen > 0)
+        munmap(buf, maplen);
+    else
+        mem_free(buf, len);
+}
+
+/* end the current block of dimension d (counting from the innermost),
+ * which holds n of the dimension within it */
+static int mat_close(size_t * count, size_t * shape, const size_t d)
+{
+    if (count[d] == 0 || (shape[d] && shape[d] != count[d]))
+        return -1;
+    shape[d] = count[d];
+    count[d] = 0;
+    count[d + 1]++;
+    return 0;
+}
+
+static int mat_rows(struct goptfoo_ctx *ctx, struct list *l,
+                    const char *base, const char *end, size_t * shape,
+                    size_t * ndims)
+{
+    size_t count[GOPTFOO_MAT_DIMS + 1] = { 0 }, depth = 0, level, d, start;
+    const char *p = base, *q, *sep;
+    int ret;
+
+    if ((ret = list_reserve_for(ctx, l, base, end)) != GOPTFOO_OK)
+        return ret;
+    for (;;) {
+        if ((q = memchr(p, ';', (size_t) (end - p))) == NULL)
+            q = end;
+        start = l->numi;
+        if ((ret = list_range(ctx, l, base, p, q)) != GOPTFOO_OK)
+            return ret;
+        count[0] = l->numi - start;
+        if (q == end)
+            break;
+        for (sep = q, level = 0; q < end && *q == ';'; q++)
+            level++;
+        if (level >= GOPTFOO_MAT_DIMS)
+            return fail(ctx, GOPTFOO_ESHAPE, base, sep, end, l->numi);
+        if (level > depth)
+            depth = level;
+        for (d = 0; d < level; d++)
+            if (mat_close(count, shape, d) < 0)
+                return fail(ctx, GOPTFOO_ESHAPE, base, sep, end, l->numi);
+        p = q;
+    }
+    for (d = 0; d < depth; d++)
+        if (mat_close(count, shape, d) < 0)
+            return fail(ctx, GOPTFOO_ESHAPE, base, end, end, l->numi);
+    if ((shape[depth] = count[depth]) == 0)
+        return fail(ctx, GOPTFOO_ESHAPE, base, end, end, l->numi);
+    *ndims = depth + 1;
+    return GOPTFOO_OK;
+}
+
+static int mat_parse(struct goptfoo_ctx *ctx, struct list *l,
+                     const char *arg, struct goptfoo_matrix *m)
+{
+    size_t shape[GOPTFOO_MAT_DIMS] = { 0 }, len = 0, maplen, bytes, i;
+    void *items = NULL, *buf;
+    const char *text = NULL;
+    int ret;
+
+    memset(m, 0, sizeof(*m));
+    l->items = &items;
+    l->numi = l->alloitems = 0;
+    l->list_max = 0;
+    l->fixed = l->each = 0;
+    if (!arg || *arg == '\0') {
+        ctx->code = GOPTFOO_OK;
+        return fail(ctx, GOPTFOO_ENOTSET, NULL, NULL, NULL, 0);
+    }
+    if ((ret = list_setup(ctx, l)) != GOPTFOO_OK)
+        return ret;
+    if ((ret = arg_text(ctx, arg, &text, &len, &buf, &maplen))
+        != GOPTFOO_OK)
+        return ret;
+    ret = mat_rows(ctx, l, text, text + len, shape, &m->ndims);
+    arg_text_free(buf, len, maplen);
+
+    bytes = l->numi * l->size;
+    bytes += (GOPTFOO_MAT_ALIGN - bytes % GOPTFOO_MAT_ALIGN)
+        % GOPTFOO_MAT_ALIGN;
+    /* the aligned buffer does not go through items_resize, so is taken
+     * from the budget here */
+    if (ret == GOPTFOO_OK && budget_take(bytes) < 0)
+        ret = fail(ctx, GOPTFOO_EBUDGET, NULL, NULL, NULL, l->numi);
+    else if (ret == GOPTFOO_OK
+             && (errno = posix_memalign(&m->items, GOPTFOO_MAT_ALIGN,
+                                        bytes))) {
+        budget_give(bytes);
+        ret = fail_nomem(ctx, l->numi);
+    }
+    if (ret != GOPTFOO_OK) {
+        items_free(ctx->alloc, items, l->alloitems * l->size);
+        m->items = NULL;
+        m->ndims = 0;
+        return ret;
+    }
+    memcpy(m->items, items, l->numi * l->size);
+    memset((char *) m->items + l->numi * l->size, 0,
+           bytes - l->numi * l->size);
+    items_free(ctx->alloc, items, l->alloitems * l->size);
+
+    m->numitems = l->numi;
+    m->bytes = bytes;
+    for (i = 0; i < m->ndims; i++)
+        m->shape[i] = shape[m->ndims - 1 - i];
+    m->stride[m->ndims - 1] = 1;
+    for (i = m->ndims - 1; i > 0; i--)
+        m->stride[i - 1] = m->stride[i] * m->shape[i];
+    return GOPTFOO_OK;
+}
+
+int goptfoo_parse_matrix_d(struct goptfoo_ctx *ctx, const char *arg,
+                           const double min, const double max,
+                           struct goptfoo_matrix *matrix)
+{
+    struct list l;
+
+    l.type = LIST_D;
+    l.size = sizeof(double);
+    l.min.d = min;
+    l.max.d = max;
+    return mat_parse(ctx, &l, arg, matrix);
+}
+
+int goptfoo_parse_matrix_ll(struct goptfoo_ctx *ctx, const char *arg,
+                            const long long min, const long long max,
+                            struct goptfoo_matrix *matrix)
+{
+    struct list l;
+
+    l.type = LIST_LL;
+    l.size = sizeof(long long);
+    l.min.ll = min;
+    l.max.ll = max;
+    return mat_parse(ctx, &l, arg, matrix);
+}
+
+void goptfoo_matrix_free(struct goptfoo_matrix *matrix)
+{
+    if (matrix->items)
+        budget_give(matrix->bytes);
+    free(matrix->items);
+    memset(matrix, 0, sizeof(*matrix));
+}
+
+/* goptfoo_reduce_* *************************************************** */
+
+/* the reducers are goptfoo_each_* lists, and so check each value just as
+ * those do, with a callback that gathers the values into a block. each
+ * block is summed with Neumaier's variant of Kahan summation, and its
+ * mean and sum of squared differences from that mean found in a second
+ * pass; these are then merged into the totals as in Chan, Golub, and
+ * LeVeque, which is as stable as Welford's update but needs only the
+ * one division per block */
+
+struct reduce {
+    struct goptfoo_summary *st;
+    int type;
+    size_t n;
+    union {
+        double d[GOPTFOO_BLOCK];
+        long long ll[GOPTFOO_BLOCK];
+        unsigned long ul[GOPTFOO_BLOCK];
+    } v;
+};
+
+void goptfoo_summary_init(struct goptfoo_summary *summary)
+{
+    memset(summary, 0, sizeof(*summary));
+}
+
+void goptfoo_summary_hist(struct goptfoo_summary *summary,
+                          const double lo, const double hi, size_t *bins,
+                          const size_t nbins)
+{
+    summary->lo = lo;
+    summary->hi = hi;
+    summary->bins = bins;
+    summary->nbins = nbins;
+    summary->below = summary->above = 0;
+    if (bins)
+        memset(bins, 0, nbins * sizeof(size_t));
+}
+
+/* the sample variance */
+double goptfoo_summary_var(const struct goptfoo_summary *summary)
+{
+    if (summary->count < 2)
+        return NAN;
+    return summary->m2 / (double) (summary->count - 1);
+}
+
+static gf_inline void neumaier(double *sum, double *comp, const double x)
+{
+    double t = *sum + x;
+
+    if (fabs(*sum) >= fabs(x))
+        *comp += (*sum - t) + x;
+    else
+        *comp += (x - t) + *sum;
+    *sum = t;
+}
+
+/* the min and max in the type of the list, and the values as doubles for
+ * the rest */
+#define REDUCE_MINMAX(T, m)                                             \
+    do {                                                                \
+        T lo = st->count ? st->min.m : r->v.m[0];                       \
+        T hi = st->count ? st->max.m : r->v.m[0];                       \
+        for (i = 0; i < n; i++) {                                       \
+            lo = r->v.m[i] < lo ? r->v.m[i] : lo;                       \
+            hi = r->v.m[i] > hi ? r->v.m[i] : hi;                       \
+            x[i] = (double) r->v.m[i];                                  \
+        }                                                               \
+        st->min.m = lo;                                                 \
+        st->max.m = hi;                                                 \
+    } while (0)
+
+static void reduce_flush(struct reduce *r)
+{
+    struct goptfoo_summary *st = r->st;
+    double x[GOPTFOO_BLOCK], sum = 0, comp = 0, mean, m2, d, scale;
+    double lsum[4] = { 0 }, lcomp[4] = { 0 }, lm2[4] = { 0 };
+    const size_t n = r->n;
+    size_t i, j, b;
+
+    if (n == 0)
+        return;
+    r->n = 0;
+    switch (r->type) {
+    case LIST_D:
+        REDUCE_MINMAX(double, d);
+        break;
+    case LIST_LL:
+        REDUCE_MINMAX(long long, ll);
+        break;
+    default:
+        REDUCE_MINMAX(unsigned long, ul);
+        break;
+    }
+
+    /* in four lanes, so that the adds need not wait on one another */
+    for (i = 0; i + 4 <= n; i += 4)
+        for (j = 0; j < 4; j++)
+            neumaier(&lsum[j], &lcomp[j], x[i + j]);
+    for (; i < n; i++)
+        neumaier(&lsum[0], &lcomp[0], x[i]);
+    for (j = 0; j < 4; j++) {
+        neumaier(&sum, &comp, lsum[j]);
+        comp += lcomp[j];
+    }
+    mean = (sum + comp) / (double) n;
+    for (i = 0; i + 4 <= n; i += 4)
+        for (j = 0; j < 4; j++) {
+            d = x[i + j] - mean;
+            lm2[j] += d * d;
+        }
+    for (; i < n; i++) {
+        d = x[i] - mean;
+        lm2[0] += d * d;
+    }
+    m2 = (lm2[0] + lm2[1]) + (lm2[2] + lm2[3]);
+
+    d = mean - st->mean;
+    st->mean += d * (double) n / (double) (st->count + n);
+    st->m2 += m2 + d * d * (double) st->count * (double) n
+        / (double) (st->count + n);
+    neumaier(&st->kahan[0], &st->kahan[1], sum);
+    neumaier(&st->kahan[0], &st->kahan[1], comp);
+    st->sum = st->kahan[0] + st->kahan[1];
+    st->count += n;
+
+    if (!st->bins || st->nbins == 0 || !(st->hi > st->lo))
+        return;
+    scale = (double) st->nbins / (st->hi - st->lo);
+    for (i = 0; i < n; i++) {
+        if (!(x[i] >= st->lo)) {
+            st->below++;
+        } else if (x[i] >= st->hi) {
+            st->above++;
+        } else {
+            /* the top bin may be overshot by rounding */
+            b = (size_t) ((x[i] - st->lo) * scale);
+            st->bins[b < st->nbins ? b : st->nbins - 1]++;
+        }
+    }
+}
+
+static int reduce_d(double value, void *data)
+{
+    struct reduce *r = data;
+
+    r->v.d[r->n++] = value;
+    if (r->n == GOPTFOO_BLOCK)
+        reduce_flush(r);
+    return 0;
+}
+
+static int reduce_ll(long long value, void *data)
+{
+    struct reduce *r = data;
+
+    r->v.ll[r->n++] = value;
+    if (r->n == GOPTFOO_BLOCK)
+        reduce_flush(r);
+    return 0;
+}
+
+static int reduce_ul(unsigned long value, void *data)
+{
+    struct reduce *r = data;
+
+    r->v.ul[r->n++] = value;
+    if (r->n == GOPTFOO_BLOCK)
+        reduce_flush(r);
+    return 0;
+}
+
+/* values before an error are kept, as they would be in a list */
+static int list_reduce(struct goptfoo_ctx *ctx, struct list *l,
+                       const char *arg, struct goptfoo_summary *summary,
+                       const size_t list_min, size_t list_max)
+{
+    struct reduce r;
+    void *none = NULL;
+    size_t numi;
+    int ret;
+
+    r.st = summary;
+    r.type = l->type;
+    r.n = 0;
+    l->items = &none;
+    l->numi = 0;
+    l->alloitems = SIZE_MAX;
+    l->list_max = list_max ? list_max : SIZE_MAX;
+    l->fixed = l->each = 1;
+    l->data = &r;
+    ret = list_parse(ctx, l, arg, list_min, &numi);
+    reduce_flush(&r);
+    return ret;
+}
+
+int goptfoo_reduce_lods(struct goptfoo_ctx *ctx, const char *arg,
+                        const double min, const double max,
+                        struct goptfoo_summary *summary,
+                        const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_D;
+    l.size = sizeof(double);
+    l.min.d = min;
+    l.max.d = max;
+    l.fn.d = reduce_d;
+    return list_reduce(ctx, &l, arg, summary, list_min, list_max);
+}
+
+int goptfoo_reduce_lolls(struct goptfoo_ctx *ctx, const char *arg,
+                         const long long min, const long long max,
+                         struct goptfoo_summary *summary,
+                         const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_LL;
+    l.size = sizeof(long long);
+    l.min.ll = min;
+    l.max.ll = max;
+    l.fn.ll = reduce_ll;
+    return list_reduce(ctx, &l, arg, summary, list_min, list_max);
+}
+
+int goptfoo_reduce_louls(struct goptfoo_ctx *ctx, const char *arg,
+                         const unsigned long min, const unsigned long max,
+                         struct goptfoo_summary *summary,
+                         const size_t list_min, size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_UL;
+    l.size = sizeof(unsigned long);
+    l.min.ul = min;
+    l.max.ul = max;
+    l.fn.ul = reduce_ul;
+    return list_reduce(ctx, &l, arg, summary, list_min, list_max);
+}
+
+/* goptfoo_opts_* ***************************************************** */
+
+/* long options are found with a perfect hash built when the table is
+ * indexed (hash and displace: the names are put into small buckets by
+ * one hash, and then each bucket, largest first, is given the first
+ * displacement that sends all its names to free slots), so a lookup is
+ * one hash of the name and one string compare however large the table.
+ * short options are looked up directly by their character */
+
+/* FNV-1a, of len bytes as --name=value needs only the name */
+static uint64_t opts_hash(const char *s, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+
+    while (len--) {
+        h ^= (unsigned char) *s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* the slot (or with d == 0, bucket) of a name, via the murmur3 64-bit
+ * finalizer */
+static size_t opts_slot(uint64_t h, const size_t d, const size_t mask)
+{
+    h += (uint64_t) d * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return (size_t) h & mask;
+}
+
+static int opts_bad(struct goptfoo_ctx *ctx, const struct goptfoo_opt *o,
+                    const size_t i)
+{
+    if (o->longname)
+        return fail(ctx, GOPTFOO_ETABLE, o->longname, o->longname,
+                    o->longname + strlen(o->longname), i);
+    return fail(ctx, GOPTFOO_ETABLE, NULL, NULL, NULL, i);
+}
+
+/* give each bucket of long names a displacement; keys holds the table
+ * index of each long name, grouped by bucket from bstart */
+static int opts_place(struct goptfoo_ctx *ctx, struct goptfoo_opts *opts,
+                      const uint64_t * hs, const size_t * keys,
+                      const size_t * bstart, const size_t nbuckets,
+                      const size_t maxsize)
+{
+    size_t b, d, i, j, k, s, size;
+
+    for (size = maxsize; size > 0; size--) {
+        for (b = 0; b < nbuckets; b++) {
+            if (bstart[b + 1] - bstart[b] != size)
+                continue;
+            for (i = bstart[b]; i < bstart[b + 1]; i++)
+                for (j = bstart[b]; j < i; j++)
+                    if (strcmp(opts->table[keys[i]].longname,
+                               opts->table[keys[j]].longname) == 0)
+                        return opts_bad(ctx, &opts->table[keys[i]],
+                                        keys[i]);
+            for (d = 1; d <= opts->mask * 64; d++) {
+                for (i = bstart[b]; i < bstart[b + 1]; i++) {
+                    s = opts_slot(hs[i], d, opts->mask);
+                    if (opts->slots[s])
+                        break;
+                    opts->slots[s] = keys[i] + 1;
+                }
+                if (i == bstart[b + 1])
+                    break;
+                for (k = bstart[b]; k < i; k++)
+                    opts->slots[opts_slot(hs[k], d, opts->mask)] = 0;
+            }
+            /* only names that hash alike in all 64 bits end up here */
+            if (d > opts->mask * 64)
+                return opts_bad(ctx, &opts->table[keys[bstart[b]]],
+                                keys[bstart[b]]);
+            opts->disp[b] = d;
+        }
+    }
+    return GOPTFOO_OK;
+}
+
+static int opts_index(struct goptfoo_ctx *ctx, struct goptfoo_opts *opts,
+                      const size_t nlong)
+{
+    size_t b, i, k, maxsize = 0, nbuckets, nslots = 1;
+    size_t *bstart = NULL, *keys = NULL;
+    uint64_t *hs = NULL, *hk = NULL;
+    int ret = GOPTFOO_OK;
+
+    /* at most half the slots are used, and the buckets hold two to
+     * four names on average */
+    while (nslots < nlong * 2)
+        nslots <<= 1;
+    nbuckets = nslots >= 8 ? nslots / 8 : 1;
+    opts->mask = nslots - 1;
+    opts->bmask = nbuckets - 1;
+
+    if ((opts->byshort = mem_zero(UCHAR_MAX + 1 + nbuckets + nslots,
+                                  sizeof(size_t), &ret)) == NULL)
+        return fail_alloc(ctx, ret, 0);
+    opts->disp = opts->byshort + UCHAR_MAX + 1;
+    opts->slots = opts->disp + nbuckets;
+    if (nlong == 0)
+        return GOPTFOO_OK;
+
+    if ((bstart = mem_zero(nbuckets + 1, sizeof(size_t), &ret)) == NULL
+        || (keys = mem_resize(NULL, 0, nlong * sizeof(size_t), &ret)) == NULL
+        || (hs = mem_resize(NULL, 0, nlong * sizeof(uint64_t), &ret)) == NULL
+        || (hk = mem_resize(NULL, 0, nlong * sizeof(uint64_t), &ret))
+        == NULL) {
+        ret = fail_alloc(ctx, ret, 0);
+        goto DONE;
+    }
+
+    /* a counting sort of the long names by bucket */
+    for (i = 0, k = 0; i < opts->count; i++) {
+        const char *name = opts->table[i].longname;
+        if (!name)
+            continue;
+        hk[k] = opts_hash(name, strlen(name));
+        bstart[opts_slot(hk[k], 0, opts->bmask) + 1]++;
+        k++;
+    }
+    for (b = 0; b < nbuckets; b++) {
+        if (bstart[b + 1] > maxsize)
+            maxsize = bstart[b + 1];
+        bstart[b + 1] += bstart[b];
+    }
+    for (i = 0, k = 0; i < opts->count; i++) {
+        if (!opts->table[i].longname)
+            continue;
+        b = opts_slot(hk[k], 0, opts->bmask);
+        /* bstart[b] moves along as the bucket fills, and is put back
+         * below */
+        hs[bstart[b]] = hk[k];
+        keys[bstart[b]++] = i;
+        k++;
+    }
+    for (b = nbuckets; b > 0; b--)
+        bstart[b] = bstart[b - 1];
+    bstart[0] = 0;
+
+    ret = opts_place(ctx, opts, hs, keys, bstart, nbuckets, maxsize);
+
+  DONE:
+    mem_free(bstart, (nbuckets + 1) * sizeof(size_t));
+    mem_free(keys, nlong * sizeof(size_t));
+    mem_free(hs, nlong * sizeof(uint64_t));
+    mem_free(hk, nlong * sizeof(uint64_t));
+    if (ret != GOPTFOO_OK)
+        goptfoo_opts_free(opts);
+    return ret;
+}
+
+/* the bounds of the narrow list types are given in the wider members of
+ * the table, and are clamped to the limits of the type; a table entry
+ * whose range has no value of the type in it is an error */
+static long long opts_ll(const long long v, const long long lo,
+                         const long long hi)
+{
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+static unsigned long opts_ul(const unsigned long v, const unsigned long hi)
+{
+    return v > hi ? hi : v;
+}
+
+static float opts_f(const double v)
+{
+    if (isfinite(v) && fabs(v) > FLT_MAX)
+        return v < 0 ? -FLT_MAX : FLT_MAX;
+    return (float) v;
+}
+
+static int opts_range(const struct goptfoo_opt *o)
+{
+    switch (o->type) {
+    case GOPTFOO_OPT_LOFS:
+        return (isfinite(o->min.d) && o->min.d > FLT_MAX)
+            || (isfinite(o->max.d) && o->max.d < -FLT_MAX) ? -1 : 0;
+    case GOPTFOO_OPT_LOI32S:
+        return o->min.ll > INT32_MAX || o->max.ll < INT32_MIN ? -1 : 0;
+    case GOPTFOO_OPT_LOI16S:
+        return o->min.ll > INT16_MAX || o->max.ll < INT16_MIN ? -1 : 0;
+    case GOPTFOO_OPT_LOU32S:
+        return o->min.ul > UINT32_MAX ? -1 : 0;
+    case GOPTFOO_OPT_LOU8S:
+        return o->min.ul > UINT8_MAX ? -1 : 0;
+    default:
+        return 0;
+    }
+}
+
+int goptfoo_opts_init(struct goptfoo_ctx *ctx, struct goptfoo_opts *opts,
+                      const struct goptfoo_opt *table, const size_t count)
+{
+    const struct goptfoo_opt *o;
+    size_t i, nlong = 0;
+    int ret;
+
+    ctx->code = GOPTFOO_OK;
+    memset(opts, 0, sizeof(*opts));
+    opts->table = table;
+    opts->count = count;
+    opts->optind = 1;
+
+    for (i = 0; i < count; i++) {
+        o = &table[i];
+        if ((!o->shortname && !o->longname)
+            || o->shortname < 0 || o->shortname > UCHAR_MAX
+            || o->shortname == '-' || (o->shortname && !isgraph(o->shortname))
+            || (o->longname && (*o->longname == '\0'
+                                || strchr(o->longname, '=')))
+            || o->type < GOPTFOO_OPT_FLAG || o->type > GOPTFOO_OPT_SET
+            || !o->dest || (o->type >= GOPTFOO_OPT_LODS
+                            && o->type <= GOPTFOO_OPT_LOU8S && !o->numitems)
+            || opts_range(o) < 0)
+            return opts_bad(ctx, o, i);
+        if (o->longname)
+            nlong++;
+    }
+    if ((ret = opts_index(ctx, opts, nlong)) != GOPTFOO_OK)
+        return ret;
+    for (i = 0; i < count; i++) {
+        if (!table[i].shortname)
+            continue;
+        if (opts->byshort[table[i].shortname]) {
+            goptfoo_opts_free(opts);
+            return opts_bad(ctx, &table[i], i);
+        }
+        opts->byshort[table[i].shortname] = i + 1;
+    }
+    return GOPTFOO_OK;
+}
+
+static const struct goptfoo_opt *opts_long(const struct goptfoo_opts *opts,
+                                           const char *name, size_t len)
+{
+    const struct goptfoo_opt *o;
+    uint64_t h = opts_hash(name, len);
+    size_t i;
+
+    i = opts->slots[opts_slot(h, opts->disp[opts_slot(h, 0, opts->bmask)],
+                              opts->mask)];
+    if (i == 0)
+        return NULL;
+    o = &opts->table[i - 1];
+    if (strncmp(o->longname, name, len) != 0 || o->longname[len] != '\0')
+        return NULL;
+    return o;
+}
+
+/* hand the value to the parse function for the type */
+static int opts_value(struct goptfoo_ctx *ctx, const struct goptfoo_opt *o,
+                      const char *arg)
+{
+    switch (o->type) {
+    case GOPTFOO_OPT_FLAG:
+        ++*(int *) o->dest;
+        return GOPTFOO_OK;
+    case GOPTFOO_OPT_STR:
+        *(const char **) o->dest = arg;
+        return GOPTFOO_OK;
+    case GOPTFOO_OPT_D:
+        return goptfoo_parse_d(ctx, arg, o->min.d, o->max.d, o->dest);
+    case GOPTFOO_OPT_LL:
+        return goptfoo_parse_ll(ctx, arg, o->min.ll, o->max.ll, o->dest);
+    case GOPTFOO_OPT_UL:
+        return goptfoo_parse_ul(ctx, arg, o->min.ul, o->max.ul, o->dest);
+    case GOPTFOO_OPT_LODS:
+        return goptfoo_parse_lods(ctx, arg, o->min.d, o->max.d, o->dest,
+                                  o->numitems, o->list_min, o->list_max);
+    case GOPTFOO_OPT_LOLLS:
+        return goptfoo_parse_lolls(ctx, arg, o->min.ll, o->max.ll, o->dest,
+                                   o->numitems, o->list_min, o->list_max);
+    case GOPTFOO_OPT_LOULS:
+        return goptfoo_parse_louls(ctx, arg, o->min.ul, o->max.ul, o->dest,
+                                   o->numitems, o->list_min, o->list_max);
+    case GOPTFOO_OPT_LOFS:
+        return goptfoo_parse_lofs(ctx, arg, opts_f(o->min.d),
+                                  opts_f(o->max.d), o->dest, o->numitems,
+                                  o->list_min, o->list_max);
+    case GOPTFOO_OPT_LOI32S:
+        return goptfoo_parse_loi32s(ctx, arg,
+                                    (int32_t) opts_ll(o->min.ll, INT32_MIN,
+                                                      INT32_MAX),
+                                    (int32_t) opts_ll(o->max.ll, INT32_MIN,
+                                                      INT32_MAX), o->dest,
+                                    o->numitems, o->list_min, o->list_max);
+    case GOPTFOO_OPT_LOI16S:
+        return goptfoo_parse_loi16s(ctx, arg,
+                                    (int16_t) opts_ll(o->min.ll, INT16_MIN,
+                                                      INT16_MAX),
+                                    (int16_t) opts_ll(o->max.ll, INT16_MIN,
+                                                      INT16_MAX), o->dest,
+                                    o->numitems, o->list_min, o->list_max);
+    case GOPTFOO_OPT_LOU32S:
+        return goptfoo_parse_lou32s(ctx, arg,
+                                    (uint32_t) opts_ul(o->min.ul, UINT32_MAX),
+                                    (uint32_t) opts_ul(o->max.ul, UINT32_MAX),
+                                    o->dest, o->numitems, o->list_min,
+                                    o->list_max);
+    case GOPTFOO_OPT_LOU8S:
+        return goptfoo_parse_lou8s(ctx, arg,
+                                   (uint8_t) opts_ul(o->min.ul, UINT8_MAX),
+                                   (uint8_t) opts_ul(o->max.ul, UINT8_MAX),
+                                   o->dest, o->numitems, o->list_min,
+                                   o->list_max);
+    default:
+        return goptfoo_parse_set(ctx, arg, o->min.ul, o->max.ul, o->dest,
+                                 o->list_min, o->list_max);
+    }
+}
+
+/* an error about the option itself; the token is the option as given */
+static int opts_fail(struct goptfoo_ctx *ctx, struct goptfoo_opts *opts,
+                     const int code, const int i,
+                     const struct goptfoo_opt *o, const char *tok,
+                     const size_t len)
+{
+    opts->optind = i;
+    opts->opt = o;
+    fail(ctx, code, tok, tok, tok + len, 0);
+    return code;
+}
+
+/* getopt(3) with long options: -abc bundles flags, -dVALUE or -d VALUE
+ * and --delay=VALUE or --delay VALUE give values, "--" ends the options
+ * as does the first operand (or a lone "-") */
+int goptfoo_opts_parse(struct goptfoo_ctx *ctx, struct goptfoo_opts *opts,
+                       int argc, char *argv[])
+{
+    const struct goptfoo_opt *o;
+    const char *a, *arg, *p;
+    size_t len;
+    int i = opts->optind, ret;
+
+    ctx->code = GOPTFOO_OK;
+    opts->opt = NULL;
+    while (i < argc && (a = argv[i])[0] == '-' && a[1] != '\0') {
+        if (a[1] == '-') {
+            if (a[2] == '\0') {
+                i++;
+                break;
+            }
+            p = strchr(a + 2, '=');
+            len = p ? (size_t) (p - a) : strlen(a);
+            if ((o = opts_long(opts, a + 2, len - 2)) == NULL)
+                return opts_fail(ctx, opts, GOPTFOO_EOPTION, i, NULL, a,
+                                 len);
+            if (o->type == GOPTFOO_OPT_FLAG) {
+                if (p)
+                    return opts_fail(ctx, opts, GOPTFOO_EOPTARG, i, o, a,
+                                     len);
+                arg = NULL;
+            } else if (p) {
+                arg = p + 1;
+            } else if (i + 1 < argc) {
+                arg = argv[++i];
+            } else {
+                return opts_fail(ctx, opts, GOPTFOO_EOPTARG, i, o, a, len);
+            }
+        } else {
+            for (p = a + 1;; p++) {
+                if ((o = opts->byshort[(unsigned char) *p]
+                     ? &opts->table[opts->byshort[(unsigned char) *p] - 1]
+                     : NULL) == NULL)
+                    return opts_fail(ctx, opts, GOPTFOO_EOPTION, i, NULL,
+                                     p, 1);
+                if (o->type != GOPTFOO_OPT_FLAG || p[1] == '\0')
+                    break;
+                ++*(int *) o->dest;
+            }
+            if (o->type == GOPTFOO_OPT_FLAG)
+                arg = NULL;
+            else if (p[1] != '\0')
+                arg = p + 1;
+            else if (i + 1 < argc)
+                arg = argv[++i];
+            else
+                return opts_fail(ctx, opts, GOPTFOO_EOPTARG, i, o, p, 1);
+        }
+        if ((ret = opts_value(ctx, o, arg)) != GOPTFOO_OK) {
+            opts->optind = arg && arg == argv[i] ? i - 1 : i;
+            opts->opt = o;
+            return ret;
+        }
+        i++;
+    }
+    opts->optind = i;
+    return GOPTFOO_OK;
+}
+
+void goptfoo_opts_free(struct goptfoo_opts *opts)
+{
+    mem_free(opts->byshort, (UCHAR_MAX + 1 + opts->bmask + 1 + opts->mask + 1)
+             * sizeof(size_t));
+    opts->byshort = opts->disp = opts->slots = NULL;
+}
+
+/* goptfoo_kv_* ******************************************************* */
+
+/* key=value entries are split on whitespace as other lists are. the
+ * words are counted first so that the values, the key offsets, and the
+ * index are each allocated once, with the index at most half full; only
+ * the arena of keys grows as the parse goes. an index slot holds 32
+ * bits of the hash of its key beside the item number, which spares most
+ * of the string compares when probing. as for lists the values are
+ * checked against min and max all at once after they have been parsed */
+
+struct goptfoo_kv_slot {
+    uint32_t hash;
+    uint32_t item;              /* item number + 1, or 0 when free */
+};
+
+/* slots are found by 32 bits of hash, so at most 2^31 of them may be
+ * used; an item takes no more than 32 bytes of values, key offsets and
+ * index all told */
+static size_t kv_cap(void)
+{
+    size_t cap = (size_t) UINT32_MAX >> 1;
+
+    if (cap > SIZE_MAX / 32)
+        cap = SIZE_MAX / 32;
+    return cap;
+}
+
+/* eight bytes at a time with the round of the cache keys */
+static uint32_t kv_hash(const char *key, size_t len)
+{
+    uint64_t h = 0x9E3779B97F4A7C15ULL, w;
+
+    for (; len >= 8; key += 8, len -= 8) {
+        memcpy(&w, key, sizeof(w));
+        h = cache_round(h, w);
+    }
+    w = (uint64_t) len << 56;
+    memcpy(&w, key, len);
+    return (uint32_t) cache_fmix(cache_round(h, w));
+}
+
+/* the end of the key that starts at p: the first '=', NUL, or space */
+static gf_inline const char *kv_stop(const char *p, const char *end)
+{
+#ifdef GOPTFOO_SWAR
+    const uint64_t h = 0x8080808080808080ULL, l7 = 0x7F7F7F7F7F7F7F7FULL;
+    uint64_t v, x, stop;
+    while (end - p >= 8) {
+        memcpy(&v, p, sizeof(v));
+        x = v ^ 0x3D3D3D3D3D3D3D3DULL;
+        stop = swar_spaces8(v) | (~(((x & l7) + l7) | x) & h)
+            | (~(((v & l7) + l7) | v) & h);
+        if (stop)
+            return p + (__builtin_ctzll(stop) >> 3);
+        p += 8;
+    }
+#endif
+    while (p < end && *p != '=' && *p != '\0' && !gf_isspace(*p))
+        p++;
+    return p;
+}
+
+/* the slot that holds the key of len bytes, or else the free slot where
+ * it would go */
+static size_t kv_slot(const struct goptfoo_kv *kv, const char *key,
+                      const size_t len, const uint32_t h)
+{
+    const struct goptfoo_kv_slot *slot;
+    const char *k;
+    size_t s;
+
+    for (s = h & kv->mask;; s = (s + 1) & kv->mask) {
+        slot = &kv->index[s];
+        if (slot->item == 0)
+            return s;
+        if (slot->hash == h) {
+            k = kv->arena + kv->keys[slot->item - 1];
+            if (strncmp(k, key, len) == 0 && k[len] == '\0')
+                return s;
+        }
+    }
+}
+
+/* copy the key of the next item into the arena */
+static int kv_key(struct goptfoo_ctx *ctx, struct goptfoo_kv *kv,
+                  const char *key, const size_t len)
+{
+    size_t want = kv->allocarena ? kv->allocarena : 256;
+    char *p;
+    int ret;
+
+    if (len >= kv->allocarena - kv->arenalen) {
+        while (len >= want - kv->arenalen)
+            want <<= 1;
+        if ((p = mem_resize(kv->arena, kv->allocarena, want, &ret)) == NULL)
+            return fail_alloc(ctx, ret, kv->numitems);
+        STATS_REALLOC(want);
+        kv->arena = p;
+        kv->allocarena = want;
+    }
+    kv->keys[kv->numitems] = kv->arenalen;
+    memcpy(kv->arena + kv->arenalen, key, len);
+    kv->arena[kv->arenalen + len] = '\0';
+    kv->arenalen += len + 1;
+    return GOPTFOO_OK;
+}
+
+/* scan the value of item index at p, which must run to whitespace or
+ * the end of the input */
+static gf_inline int kv_value(struct goptfoo_ctx *ctx, const struct list *l,
+                              const char *base, const char *p,
+                              const char *end, const char **ep,
+                              const size_t index, union goptfoo_value *value)
+{
+    const int radix = flags_radix(ctx->flags);
+    int ret;
+
+    if (p == end || gf_isspace(*p))
+        return fail(ctx, GOPTFOO_EPARSE, base, p, end, index);
+    if (l->type == LIST_D) {
+        ret = scan_d(p, end, ep, &value->d);
+    } else if (l->type == LIST_LL) {
+        ret = scan_ll(p, end, ep, &value->ll, radix);
+    } else {
+        if (*p != '+' && !gf_isradix(*p, radix))
+            return fail(ctx, GOPTFOO_ENEGATIVE, base, p, end, index);
+        ret = scan_ul(p, end, ep, &value->ul, radix);
+    }
+    if (ret == SCAN_NOMEM)
+        return fail_nomem(ctx, 0);
+    if (ret == SCAN_NONE || (*ep != end && !gf_isspace(**ep)))
+        return fail(ctx, GOPTFOO_EPARSE, base, p, end, index);
+    if (ret == SCAN_RANGE)
+        return fail(ctx, GOPTFOO_ERANGE, base, p, end, index);
+    return GOPTFOO_OK;
+}
+
+/* the value of item i, found again for a min or max error */
+static const char *kv_word(const char *p, const char *end, size_t i)
+{
+    for (;;) {
+        while (p < end && gf_isspace(*p))
+            p++;
+        if (i-- == 0)
+            break;
+        while (p < end && !gf_isspace(*p))
+            p++;
+    }
+    while (*p != '=')
+        p++;
+    return p + 1;
+}
+
+static int kv_parse(struct goptfoo_ctx *ctx, const struct list *l,
+                    const char *arg, struct goptfoo_kv *kv,
+                    const size_t list_min, size_t list_max)
+{
+    const char *text = NULL, *end, *p, *key, *eq;
+    size_t len = 0, maplen = 0, words, slots, s, bad;
+    union goptfoo_value value;
+    void *buf = NULL;
+    char *arena;
+    uint32_t h;
+    int code = GOPTFOO_OK, ret;
+    STATS_START(GOPTFOO_STATS_LIST, t0);
+
+    memset(kv, 0, sizeof(*kv));
+    ctx->code = GOPTFOO_OK;
+    if (!arg || *arg == '\0')
+        return fail(ctx, GOPTFOO_ENOTSET, NULL, NULL, NULL, 0);
+    if (list_max > kv_cap())
+        return fail(ctx, GOPTFOO_ELISTMAX, NULL, NULL, NULL, 0);
+    if (list_max == 0)
+        list_max = kv_cap();
+    if ((ret = arg_text(ctx, arg, &text, &len, &buf, &maplen))
+        != GOPTFOO_OK)
+        return ret;
+    end = text + len;
+
+    /* each entry is one word; past list_max is an error in any case */
+    if ((words = count_words(text, end)) > list_max)
+        words = list_max;
+    for (slots = 2; slots < words * 2; slots <<= 1) ;
+    if ((kv->index = mem_zero(slots, sizeof(struct goptfoo_kv_slot), &ret))
+        == NULL) {
+        ret = fail_alloc(ctx, ret, words);
+        goto DONE;
+    }
+    kv->mask = slots - 1;
+    kv->allocitems = words ? words : 1;
+    kv->size = l->size;
+    if ((kv->values = mem_resize(NULL, 0, kv->allocitems * l->size, &ret))
+        == NULL
+        || (kv->keys = mem_resize(NULL, 0, kv->allocitems * sizeof(size_t),
+                                  &ret)) == NULL) {
+        ret = fail_alloc(ctx, ret, words);
+        goto DONE;
+    }
+
+    for (p = text;;) {
+        while (p < end && gf_isspace(*p))
+            p++;
+        if (p == end)
+            break;
+        eq = kv_stop(key = p, end);
+        if (eq == key || eq == end || *eq != '=') {
+            ret = fail(ctx, GOPTFOO_EKEY, text, key, end, kv->numitems);
+            goto DONE;
+        }
+        if (kv->numitems == list_max) {
+            ret = fail(ctx, GOPTFOO_ETOOMANY, text, key, end, kv->numitems);
+            goto DONE;
+        }
+        if ((ret = kv_value(ctx, l, text, eq + 1, end, &p, kv->numitems,
+                            &value)) != GOPTFOO_OK)
+            goto DONE;
+        h = kv_hash(key, (size_t) (eq - key));
+        s = kv_slot(kv, key, (size_t) (eq - key), h);
+        if (kv->index[s].item) {
+            ret = fail(ctx, GOPTFOO_EDUPKEY, text, key, end, kv->numitems);
+            goto DONE;
+        }
+        if ((ret = kv_key(ctx, kv, key, (size_t) (eq - key))) != GOPTFOO_OK)
+            goto DONE;
+        memcpy((char *) kv->values + kv->numitems * l->size, &value,
+               l->size);
+        kv->index[s].hash = h;
+        kv->index[s].item = (uint32_t) ++kv->numitems;
+    }
+
+    if (kv->numitems < list_min) {
+        ret = fail(ctx, GOPTFOO_ETOOFEW, NULL, NULL, NULL, kv->numitems);
+    } else if ((bad = list_check(l, kv->values, kv->numitems, 1, &code))
+               < kv->numitems) {
+        ret = fail(ctx, code, text, kv_word(text, end, bad), end, bad);
+    } else if (kv->arenalen < kv->allocarena
+               && (arena = mem_resize(kv->arena, kv->allocarena,
+                                      kv->arenalen, &code)) != NULL) {
+        kv->arena = arena;
+        kv->allocarena = kv->arenalen;
+    }
+
+  DONE:
+    STATS_END(GOPTFOO_STATS_LIST, t0, len, kv->numitems);
+    arg_text_free(buf, len, maplen);
+    if (ret != GOPTFOO_OK)
+        goptfoo_kv_free(kv);
+    return ret;
+}
+
+int goptfoo_parse_kv_d(struct goptfoo_ctx *ctx, const char *arg,
+                       const double min, const double max,
+                       struct goptfoo_kv *kv, const size_t list_min,
+                       size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_D;
+    l.size = sizeof(double);
+    l.min.d = min;
+    l.max.d = max;
+    return kv_parse(ctx, &l, arg, kv, list_min, list_max);
+}
+
+int goptfoo_parse_kv_ll(struct goptfoo_ctx *ctx, const char *arg,
+                        const long long min, const long long max,
+                        struct goptfoo_kv *kv, const size_t list_min,
+                        size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_LL;
+    l.size = sizeof(long long);
+    l.min.ll = min;
+    l.max.ll = max;
+    return kv_parse(ctx, &l, arg, kv, list_min, list_max);
+}
+
+int goptfoo_parse_kv_ul(struct goptfoo_ctx *ctx, const char *arg,
+                        const unsigned long min, const unsigned long max,
+                        struct goptfoo_kv *kv, const size_t list_min,
+                        size_t list_max)
+{
+    struct list l;
+
+    l.type = LIST_UL;
+    l.size = sizeof(unsigned long);
+    l.min.ul = min;
+    l.max.ul = max;
+    return kv_parse(ctx, &l, arg, kv, list_min, list_max);
+}
+
+int goptfoo_kv_find(const struct goptfoo_kv *kv, const char *key, size_t * i)
+{
+    size_t len, s;
+
+    if (!kv->index)
+        return 0;
+    len = strlen(key);
+    s = kv_slot(kv, key, len, kv_hash(key, len));
+    if (kv->index[s].item == 0)
+        return 0;
+    if (i)
+        *i = kv->index[s].item - 1;
+    return 1;
+}
+
+const char *goptfoo_kv_key(const struct goptfoo_kv *kv, const size_t i)
+{
+    return kv->arena + kv->keys[i];
+}
+
+void goptfoo_kv_free(struct goptfoo_kv *kv)
+{
+    mem_free(kv->arena, kv->allocarena);
+    mem_free(kv->keys, kv->allocitems * sizeof(size_t));
+    mem_free(kv->values, kv->allocitems * kv->size);
+    mem_free(kv->index, (kv->mask + 1) * sizeof(struct goptfoo_kv_slot));
+    memset(kv, 0, sizeof(*kv));
+}
+
+/* goptfoo_parse_argv_* *********************************************** */
+
+/* each argument of the slice is scanned as goptfoo_parse_* would, into
+ * an array allocated once for all of them, and then checked against min
+ * and max a chunk at a time as list values are. with ctx->threads above
+ * one and at least ctx->thread_min bytes of arguments, the slice is cut
+ * into that many runs of arguments, each scanned by its own thread into
+ * its part of the array; the first error in argument order wins */
+
+/* scan argv[from, to) into items, adding the bytes seen to *bytes */
+static int argv_scan(struct goptfoo_ctx *ctx, const struct list *l,
+                     char *argv[], const size_t from, const size_t to,
+                     void *items, size_t * bytes)
+{
+    const int radix = flags_radix(ctx->flags);
+    const char *arg, *p, *end, *ep;
+    int code = GOPTFOO_OK, ret = GOPTFOO_OK;
+    size_t i, bad;
+
+    for (i = from; i < to; i++) {
+        if (!(arg = argv[i]) || *arg == '\0') {
+            ret = fail(ctx, GOPTFOO_ENOTSET, NULL, NULL, NULL, i);
+            break;
+        }
+        for (p = arg; gf_isspace(*p); p++) ;
+        end = p + strlen(p);
+        *bytes += (size_t) (end - arg);
+        switch (l->type) {
+        case LIST_D:
+            ret = scan_d(p, end, &ep, (double *) items + i);
+            break;
+        case LIST_LL:
+            ret = scan_ll(p, end, &ep, (long long *) items + i, radix);
+            break;
+        default:
+            if (*p != '+' && !gf_isradix(*p, radix)) {
+                ret = fail(ctx, GOPTFOO_ENEGATIVE, arg, p, end, i);
+                goto CHECK;
+            }
+            ret = scan_ul(p, end, &ep, (unsigned long *) items + i, radix);
+            break;
+        }
+        if (ret == SCAN_OK && ep == end)
+            continue;
+        if (ret == SCAN_NOMEM)
+            ret = fail_nomem(ctx, 0);
+        else if (ret == SCAN_NONE || ep != end)
+            ret = fail(ctx, GOPTFOO_EPARSE, arg, p, end, i);
+        else
+            ret = fail(ctx, GOPTFOO_ERANGE, arg, p, end, i);
+        break;
+    }
+
+    /* a value out of bounds ahead of the one that failed to scan is the
+     * first error */
+  CHECK:
+    if ((bad = list_check(l, (char *) items + from * l->size, i - from, 1,
+                          &code)) < i - from) {
+        arg = argv[from + bad];
+        for (p = arg; gf_isspace(*p); p++) ;
+        ret = fail(ctx, code, arg, p, p + strlen(p), from + bad);
+    }
+    return ret;
+}
+
+#ifdef HAVE_PTHREAD
+struct argv_chunk {
+    struct goptfoo_ctx ctx;
+    const struct list *l;
+    char **argv;
+    size_t from, to;
+    void *items;
+    size_t bytes;
+    int ret;
+};
+
+static void *argv_chunk(void *arg)
+{
+    struct argv_chunk *c = arg;
+    c->ret = argv_scan(&c->ctx, c->l, c->argv, c->from, c->to, c->items,
+                       &c->bytes);
+    return NULL;
+}
+
+/* whether the arguments come to thread_min bytes, which is only worked
+ * out as far as need be */
+static int argv_big(const struct goptfoo_ctx *ctx, char *argv[],
+                    const size_t argc)
+{
+    size_t min = ctx->thread_min ? ctx->thread_min : GOPTFOO_THREAD_MIN;
+    size_t i, bytes = 0;
+
+    for (i = 0; i < argc && bytes < min; i++)
+        if (argv[i])
+            bytes += strlen(argv[i]);
+    return bytes >= min;
+}
+
+static int argv_threaded(struct goptfoo_ctx *ctx, const struct list *l,
+                         char *argv[], const size_t argc, void *items,
+                         unsigned int n, size_t * bytes)
+{
+    struct argv_chunk chunks[GOPTFOO_THREAD_MAX];
+    pthread_t tids[GOPTFOO_THREAD_MAX];
+    int started[GOPTFOO_THREAD_MAX];
+    unsigned int i;
+    int ret = GOPTFOO_OK;
+
+    if (n < 2)
+        return argv_scan(ctx, l, argv, 0, argc, items, bytes);
+    for (i = 0; i < n; i++) {
+        struct argv_chunk *c = &chunks[i];
+        c->ctx = *ctx;
+        c->ctx.code = GOPTFOO_OK;
+        c->l = l;
+        c->argv = argv;
+        c->from = argc / n * i;
+        c->to = i == n - 1 ? argc : argc / n * (i + 1);
+        c->items = items;
+        c->bytes = 0;
+        started[i] = i > 0
+            && pthread_create(&tids[i], NULL, argv_chunk, c) == 0;
+    }
+    argv_chunk(&chunks[0]);
+    for (i = 1; i < n; i++) {
+        if (started[i])
+            pthread_join(tids[i], NULL);
+        else
+            argv_chunk(&chunks[i]);
+    }
+    for (i = 0; i < n; i++) {
+        *bytes += chunks[i].bytes;
+        if (chunks[i].ret != GOPTFOO_OK) {
+            *ctx = chunks[i].ctx;
+            ret = ctx->code;
+            break;
+        }
+    }
+    return ret;
+}
+#endif
+
+static int argv_parse(struct goptfoo_ctx *ctx, struct list *l, int argc,
+                      char *argv[], void **items)
+{
+    size_t bytes = 0;
+    int ret;
+    STATS_START(GOPTFOO_STATS_ARG, t0);
+#ifdef HAVE_PTHREAD
+    unsigned int n = ctx->threads;
+
+    if (n > GOPTFOO_THREAD_MAX)
+        n = GOPTFOO_THREAD_MAX;
+#endif
+
+    ctx->code = GOPTFOO_OK;
+    if (argc < 0 || (argc > 0 && !argv))
+        return fail(ctx, GOPTFOO_ENOTSET, NULL, NULL, NULL, 0);
+    *items = NULL;
+    l->items = items;
+    l->numi = l->alloitems = 0;
+    l->list_max = (size_t) argc;
+    l->fixed = l->each = 0;
+    if ((ret = list_reserve(ctx, l, (size_t) argc)) != GOPTFOO_OK)
+        return ret;
+
+#ifdef HAVE_PTHREAD
+    if (n > 1 && (size_t) argc >= n && argv_big(ctx, argv, (size_t) argc))
+        ret = argv_threaded(ctx, l, argv, (size_t) argc, *items, n, &bytes);
+    else
+#endif
+        ret = argv_scan(ctx, l, argv, 0, (size_t) argc, *items, &bytes);
+
+    STATS_END(GOPTFOO_STATS_ARG, t0, bytes, ret == GOPTFOO_OK ? argc : 0);
+    if (ret != GOPTFOO_OK) {
+        items_free(ctx->alloc, *items, l->alloitems * l->size);
+        *items = NULL;
+    }
+    return ret;
+}
+
+int goptfoo_parse_argv_d(struct goptfoo_ctx *ctx, int argc, char *argv[],
+                         const double min, const double max,
+                         double **items)
+{
+    struct list l;
+
+    l.type = LIST_D;
+    l.size = sizeof(double);
+    l.min.d = min;
+    l.max.d = max;
+    return argv_parse(ctx, &l, argc, argv, (void **) items);
+}
+
+int goptfoo_parse_argv_ll(struct goptfoo_ctx *ctx, int argc, char *argv[],
+                          const long long min, const long long max,
+                          long long **items)
+{
+    struct list l;
+
+    l.type = LIST_LL;
+    l.size = sizeof(long long);
+    l.min.ll = min;
+    l.max.ll = max;
+    return argv_parse(ctx, &l, argc, argv, (void **) items);
+}
+
+int goptfoo_parse_argv_ul(struct goptfoo_ctx *ctx, int argc, char *argv[],
+                          const unsigned long min, const unsigned long max,
+                          unsigned long **items)
+{
+    struct list l;
+
+    l.type = LIST_UL;
+    l.size = sizeof(unsigned long);
+    l.min.ul = min;
+    l.max.ul = max;
+    return argv_parse(ctx, &l, argc, argv, (void **) items);
+}
+
 /* argto* ************************************************************* */
 
+/* these and the other exiting functions are wrappers that turn errors
+ * from the parse functions into the messages they have always had. a
+ * single value allocates nothing, so the context is only zeroed rather
+ * than set up by goptfoo_ctx_init */
+
 double argtod(const char *argname, const char *arg, const double min,
               const double max)
 {
-    char *ep;
+    struct goptfoo_ctx ctx;
     double val;
 
-    if (!arg || *arg == '\0')
+    memset(&ctx, 0, sizeof(ctx));
+    STATS_START(GOPTFOO_STATS_ARG, t0);
+    switch (goptfoo_parse_d(&ctx, arg, min, max, &val)) {
+    case GOPTFOO_OK:
+        break;
+    case GOPTFOO_ENOTSET:
         errx(EX_DATAERR, "%s value not set", argname);
-
-    errno = 0;
-    val = strtod(arg, &ep);
-    if (arg[0] == '\0' || *ep != '\0')
-        errx(EX_DATAERR, "strtod failed on %s value '%s'", argname, arg);
-    if (errno == ERANGE)
+    case GOPTFOO_ENOMEM:
+        errno = ctx.oserr;
+        err(EX_OSERR, "could not copy %s value", argname);
+    case GOPTFOO_ERANGE:
         errx(EX_DATAERR, "value for %s is not a double", argname);
-    if (isfinite(min) && val < min)
+    case GOPTFOO_EMIN:
         errx(EX_DATAERR, "value for %s is below min %g", argname, min);
-    if (isfinite(max) && val > max)
+    case GOPTFOO_EMAX:
         errx(EX_DATAERR, "value for %s is above max %g", argname, max);
+    default:
+        errx(EX_DATAERR, "strtod failed on %s value '%s'", argname, arg);
+    }
 
+    STATS_END(GOPTFOO_STATS_ARG, t0, strlen(arg), 1);
     return val;
 }
 
 long long argtoll(const char *argname, const char *arg, const long long min,
                   const long long max)
 {
-    char *ep;
+    struct goptfoo_ctx ctx;
     long long val;
 
-    if (!arg || *arg == '\0')
+    memset(&ctx, 0, sizeof(ctx));
+    STATS_START(GOPTFOO_STATS_ARG, t0);
+    switch (goptfoo_parse_ll(&ctx, arg, min, max, &val)) {
+    case GOPTFOO_OK:
+        break;
+    case GOPTFOO_ENOTSET:
         errx(EX_DATAERR, "%s value not set", argname);
-
-    errno = 0;
-    val = strtoll(arg, &ep, 0);
-    if (arg[0] == '\0' || *ep != '\0')
-        errx(EX_DATAERR, "strtoll failed on %s value '%s'", argname, arg);
-    if (errno == ERANGE && (val == LLONG_MIN || val == LLONG_MAX))
+    case GOPTFOO_ERANGE:
         errx(EX_DATAERR, "%s value is not a long long", argname);
-    if (min != LLONG_MIN && val < min)
+    case GOPTFOO_EMIN:
         errx(EX_DATAERR, "%s value is below min %lld", argname, min);
-    if (max != LLONG_MAX && val > max)
+    case GOPTFOO_EMAX:
         errx(EX_DATAERR, "%s value is above max %lld", argname, max);
+    default:
+        errx(EX_DATAERR, "strtoll failed on %s value '%s'", argname, arg);
+    }
 
+    STATS_END(GOPTFOO_STATS_ARG, t0, strlen(arg), 1);
     return val;
 }
 
 unsigned long argtoul(const char *argname, const char *arg,
                       const unsigned long min, const unsigned long max)
 {
-    char *ep;
+    struct goptfoo_ctx ctx;
     unsigned long val;
 
-    if (!arg || *arg == '\0')
+    memset(&ctx, 0, sizeof(ctx));
+    STATS_START(GOPTFOO_STATS_ARG, t0);
+    switch (goptfoo_parse_ul(&ctx, arg, min, max, &val)) {
+    case GOPTFOO_OK:
+        break;
+    case GOPTFOO_ENOTSET:
         errx(EX_DATAERR, "%s value not set", argname);
-
-    while (isspace(*arg))
-        arg++;
-    if (*arg != '+' && !isdigit(*arg))
+    case GOPTFOO_ENEGATIVE:
         errx(EX_DATAERR, "%s value must be positive", argname);
-
-    errno = 0;
-    val = strtoul(arg, &ep, 0);
-    if (arg[0] == '\0' || *ep != '\0')
-        errx(EX_DATAERR, "strtoul failed on %s value '%s'", argname, arg);
-    if (errno == ERANGE && val == ULONG_MAX)
+    case GOPTFOO_ERANGE:
         errx(EX_DATAERR, "%s value is not an unsigned long", argname);
-    if (min != 0 && val < min)
+    case GOPTFOO_EMIN:
         errx(EX_DATAERR, "%s value is below min %lu", argname, min);
-    if (max != ULONG_MAX && val > max)
+    case GOPTFOO_EMAX:
         errx(EX_DATAERR, "%s value is above max %lu", argname, max);
+    default:
+        /* leading whitespace is not shown, as strtoul(3) once was
+         * handed the string only after that had been skipped */
+        errx(EX_DATAERR, "strtoul failed on %s value '%s'", argname,
+             arg + ctx.offset);
+    }
 
+    STATS_END(GOPTFOO_STATS_ARG, t0, strlen(arg), 1);
     return val;
 }
 
+/* argvto* ************************************************************ */
+
+/* as for argto* though with the index of the argument at fault, counted
+ * from the argv given. the min and max errors are left to the callers
+ * as their formats differ */
+static void argv_errx(const struct goptfoo_ctx *ctx, const char *argname,
+                      char *argv[], const char *tname, const char *fname)
+{
+    switch (ctx->code) {
+    case GOPTFOO_ENOTSET:
+        errx(EX_DATAERR, "%s argument %lu not set", argname, ctx->index);
+    case GOPTFOO_ENOMEM:
+        errno = ctx->oserr;
+        if (ctx->index == 0)
+            err(EX_OSERR, "could not copy %s value", argname);
+        err(EX_OSERR, "could not realloc() %lu %ss for %s", ctx->index,
+            tname, argname);
+    case GOPTFOO_EBUDGET:
+        errx(EX_OSERR, "%lu %ss for %s would go over the memory budget",
+             ctx->index, tname, argname);
+    case GOPTFOO_ENEGATIVE:
+        errx(EX_DATAERR, "%s argument %lu must be positive", argname,
+             ctx->index);
+    case GOPTFOO_ERANGE:
+        errx(EX_DATAERR, "%s argument %lu is not a%s %s", argname,
+             ctx->index, strncmp(tname, "un", 2) == 0 ? "n" : "", tname);
+    default:
+        errx(EX_DATAERR, "%s failed on %s argument %lu '%s'", fname,
+             argname, ctx->index, argv[ctx->index] + ctx->offset);
+    }
+}
+
+size_t argvtods(const char *argname, int argc, char *argv[],
+                const double min, const double max, double **items)
+{
+    struct goptfoo_ctx ctx;
+
+    goptfoo_ctx_init(&ctx);
+    switch (goptfoo_parse_argv_d(&ctx, argc, argv, min, max, items)) {
+    case GOPTFOO_OK:
+        break;
+    case GOPTFOO_EMIN:
+        errx(EX_DATAERR, "%s argument %lu is below min %g", argname,
+             ctx.index, min);
+    case GOPTFOO_EMAX:
+        errx(EX_DATAERR, "%s argument %lu is above max %g", argname,
+             ctx.index, max);
+    default:
+        argv_errx(&ctx, argname, argv, "double", "strtod");
+    }
+    return (size_t) argc;
+}
+
+size_t argvtolls(const char *argname, int argc, char *argv[],
+                 const long long min, const long long max,
+                 long long **items)
+{
+    struct goptfoo_ctx ctx;
+
+    goptfoo_ctx_init(&ctx);
+    switch (goptfoo_parse_argv_ll(&ctx, argc, argv, min, max, items)) {
+    case GOPTFOO_OK:
+        break;
+    case GOPTFOO_EMIN:
+        errx(EX_DATAERR, "%s argument %lu is below min %lld", argname,
+             ctx.index, min);
+    case GOPTFOO_EMAX:
+        errx(EX_DATAERR, "%s argument %lu is above max %lld", argname,
+             ctx.index, max);
+    default:
+        argv_errx(&ctx, argname, argv, "long long", "strtoll");
+    }
+    return (size_t) argc;
+}
+
+size_t argvtouls(const char *argname, int argc, char *argv[],
+                 const unsigned long min, const unsigned long max,
+                 unsigned long **items)
+{
+    struct goptfoo_ctx ctx;
+
+    goptfoo_ctx_init(&ctx);
+    switch (goptfoo_parse_argv_ul(&ctx, argc, argv, min, max, items)) {
+    case GOPTFOO_OK:
+        break;
+    case GOPTFOO_EMIN:
+        errx(EX_DATAERR, "%s argument %lu is below min %lu", argname,
+             ctx.index, min);
+    case GOPTFOO_EMAX:
+        errx(EX_DATAERR, "%s argument %lu is above max %lu", argname,
+             ctx.index, max);
+    default:
+        argv_errx(&ctx, argname, argv, "unsigned long", "strtoul");
+    }
+    return (size_t) argc;
+}
+
 /* flagto* ************************************************************ */
 
 double flagtod(const int flag, const char *flagarg,
                const double min, const double max)
 {
-    char *ep;
+    struct goptfoo_ctx ctx;
     double val;
 
-    if (!flagarg || *flagarg == '\0')
+    memset(&ctx, 0, sizeof(ctx));
+    STATS_START(GOPTFOO_STATS_FLAG, t0);
+    switch (goptfoo_parse_d(&ctx, flagarg, min, max, &val)) {
+    case GOPTFOO_OK:
+        break;
+    case GOPTFOO_ENOTSET:
         errx(EX_DATAERR, "flag -%c value not set", flag);
-
-    errno = 0;
-    val = strtod(flagarg, &ep);
-    if (flagarg[0] == '\0' || *ep != '\0')
-        errx(EX_DATAERR, "strtod failed on -%c value '%s'", flag, flagarg);
-    if (errno == ERANGE)
+    case GOPTFOO_ENOMEM:
+        errno = ctx.oserr;
+        err(EX_OSERR, "could not copy -%c value", flag);
+    case GOPTFOO_ERANGE:
         errx(EX_DATAERR, "value for -%c is not a double", flag);
-    if (isfinite(min) && val < min)
+    case GOPTFOO_EMIN:
         errx(EX_DATAERR, "value for -%c is below min %g", flag, min);
-    if (isfinite(max) && val > max)
+    case GOPTFOO_EMAX:
         errx(EX_DATAERR, "value for -%c is above max %g", flag, max);
+    default:
+        errx(EX_DATAERR, "strtod failed on -%c value '%s'", flag, flagarg);
+    }
 
+    STATS_END(GOPTFOO_STATS_FLAG, t0, strlen(flagarg), 1);
     return val;
 }
 
 long long flagtoll(const int flag, const char *flagarg,
                    const long long min, const long long max)
 {
-    char *ep;
+    struct goptfoo_ctx ctx;
     long long val;
 
-    if (!flagarg || *flagarg == '\0')
+    memset(&ctx, 0, sizeof(ctx));
+    STATS_START(GOPTFOO_STATS_FLAG, t0);
+    switch (goptfoo_parse_ll(&ctx, flagarg, min, max, &val)) {
+    case GOPTFOO_OK:
+        break;
+    case GOPTFOO_ENOTSET:
         errx(EX_DATAERR, "flag -%c value not set", flag);
-
-    errno = 0;
-    val = strtoll(flagarg, &ep, 0);
-    if (flagarg[0] == '\0' || *ep != '\0')
-        errx(EX_DATAERR, "strtoll failed on -%c value '%s'", flag, flagarg);
-    if (errno == ERANGE && (val == LLONG_MIN || val == LLONG_MAX))
+    case GOPTFOO_ERANGE:
         errx(EX_DATAERR, "value for -%c is not a long long", flag);
-    if (min != LLONG_MIN && val < min)
+    case GOPTFOO_EMIN:
         errx(EX_DATAERR, "value for -%c is below min %lld", flag, min);
-    if (max != LLONG_MAX && val > max)
+    case GOPTFOO_EMAX:
         errx(EX_DATAERR, "value for -%c is above max %lld", flag, max);
+    default:
+        errx(EX_DATAERR, "strtoll failed on -%c value '%s'", flag, flagarg);
+    }
 
+    STATS_END(GOPTFOO_STATS_FLAG, t0, strlen(flagarg), 1);
     return val;
 }
 
 unsigned long flagtoul(const int flag, const char *flagarg,
                        const unsigned long min, const unsigned long max)
 {
-    char *ep;
+    struct goptfoo_ctx ctx;
     unsigned long val;
 
-    if (!flagarg || *flagarg == '\0')
+    memset(&ctx, 0, sizeof(ctx));
+    STATS_START(GOPTFOO_STATS_FLAG, t0);
+    switch (goptfoo_parse_ul(&ctx, flagarg, min, max, &val)) {
+    case GOPTFOO_OK:
+        break;
+    case GOPTFOO_ENOTSET:
         errx(EX_DATAERR, "flag -%c value not set", flag);
-
-    while (isspace(*flagarg))
-        flagarg++;
-    if (*flagarg != '+' && !isdigit(*flagarg))
+    case GOPTFOO_ENEGATIVE:
         errx(EX_DATAERR, "flag -%c value must be positive", flag);
-
-    errno = 0;
-    val = strtoul(flagarg, &ep, 0);
-    if (flagarg[0] == '\0' || *ep != '\0')
-        errx(EX_DATAERR, "strtoul failed on -%c value '%s'", flag, flagarg);
-    if (errno == ERANGE && val == ULONG_MAX)
+    case GOPTFOO_ERANGE:
         errx(EX_DATAERR, "value for -%c is not an unsigned long", flag);
-    if (min != 0 && val < min)
+    case GOPTFOO_EMIN:
         errx(EX_DATAERR, "value for -%c is below min %lu", flag, min);
-    if (max != ULONG_MAX && val > max)
+    case GOPTFOO_EMAX:
         errx(EX_DATAERR, "value for -%c is above max %lu", flag, max);
+    default:
+        errx(EX_DATAERR, "strtoul failed on -%c value '%s'", flag,
+             flagarg + ctx.offset);
+    }
 
+    STATS_END(GOPTFOO_STATS_FLAG, t0, strlen(flagarg), 1);
     return val;
 }
 
 /* flagtolo*s ********************************************************* */
 
-/* there are three variables related to the number of items in these
- * flagtolo* functions; numi is sent back to the user, and should be the
- * number of items (and also *numitems unless that was NULL); list_max
- * sets a user-specified (or at most the data type allows to avoid
- * size_t overflows) high water mark, while the alloitems variable is
- * for how many items have been allocated, which will usually be above
- * the number of items and hopefully not beyond list_max */
+/* only these take the parse cache directory from GOPTFOO_CACHE; users
+ * of the goptfoo_parse_* functions set ctx->cache_dir themselves, so an
+ * environment variable cannot turn on writing to disk in a program that
+ * never asked for it */
 
-size_t flagtolods(const int flag, const char *flagarg,
-                  const double min, const double max,
-                  double **items, size_t * numitems,
-                  const size_t list_min, size_t list_max)
+/* errors common to the list functions; tname is the type name used in
+ * the messages */
+static void list_errx(const struct goptfoo_ctx *ctx, const int flag,
+                      const char *flagarg, const char *tname,
+                      const size_t size, const size_t list_min,
+                      size_t list_max)
 {
-    char *ep;
-    double value;
-    size_t alloitems = 8;       /* arbitrary starting point */
-    size_t numi = 0;
+    if (list_max == 0)
+        list_max = SIZE_MAX / size;
 
-    if (!flagarg || *flagarg == '\0')
+    switch (ctx->code) {
+    case GOPTFOO_ENOTSET:
         errx(EX_DATAERR, "flag -%c value not set", flag);
-
-    if (list_max > SIZE_MAX / sizeof(double))
-        errx(EX_DATAERR, "list_max %lu too large for double", list_max);
-    else if (list_max == 0)
-        list_max = SIZE_MAX / sizeof(double);
-
-    if (numitems) {
-        if (*numitems > list_max) {
-            errx(EX_DATAERR, "too many items in list already");
-        } else if (*numitems > 0) {
-            alloitems = *numitems << 1;
-        }
-        numi = *numitems;
+    case GOPTFOO_ELISTMAX:
+        errx(EX_DATAERR, "list_max %lu too large for %s", list_max, tname);
+    case GOPTFOO_EPREFILL:
+        errx(EX_DATAERR, "too many items in list already");
+    case GOPTFOO_ENOMEM:
+        errno = ctx->oserr;
+        if (ctx->index == 0)
+            err(EX_OSERR, "could not copy %s in -%c", tname, flag);
+        err(EX_OSERR, "could not realloc() %ld %ss for -%c", ctx->index,
+            tname, flag);
+    case GOPTFOO_EBUDGET:
+        errx(EX_OSERR, "%lu %ss for -%c would go over the memory budget",
+             ctx->index, tname, flag);
+    case GOPTFOO_EFILE:
+        errno = ctx->oserr;
+        err(EX_NOINPUT, "could not read '%s' for -%c", flagarg + 1, flag);
+    case GOPTFOO_EFORMAT:
+        errx(EX_DATAERR, "bad @bin: format or size for %s in -%c", tname,
+             flag);
+    case GOPTFOO_ECHAR:
+        errx(EX_DATAERR, "non-digit non-space character in -%c", flag);
+    case GOPTFOO_EPARSE:
+        errx(EX_DATAERR, "could not parse %s in -%c", tname, flag);
+    case GOPTFOO_ERANGE:
+        errx(EX_DATAERR, "value for -%c is not a%s %s", flag,
+             *tname == 'i' || strncmp(tname, "un", 2) == 0 ? "n" : "",
+             tname);
+    case GOPTFOO_ETOOMANY:
+        errx(EX_OSERR, "too many values specified for -%c, need only %ld",
+             flag, list_max);
+    case GOPTFOO_ETOOFEW:
+        errx(EX_DATAERR, "too few values specified for -%c, need %ld", flag,
+             list_min);
+    default:
+        errx(EX_SOFTWARE, "%s for -%c", goptfoo_strerror(ctx->code), flag);
     }
-    /* resize items to allocate down, or up if the provided list_max is
-     * "close" to the starting number of items to allocate */
-    if (alloitems > list_max || (alloitems << 2) > list_max)
-        alloitems = list_max;
+}
 
-    /* really want reallocarray(3) but that's not portable enough yet */
-    if ((*items = realloc(*items, alloitems * sizeof(double))) == NULL)
-        err(EX_OSERR, "could not realloc() %ld doubles for -%c",
-            alloitems, flag);
+size_t flagtolods(const int flag, const char *flagarg,
+                  const double min, const double max,
+                  double **items, size_t * numitems,
+                  const size_t list_min, size_t list_max)
+{
+    struct goptfoo_ctx ctx;
+    size_t numi = numitems ? *numitems : 0;
 
-    while (*flagarg != '\0') {
-        if (isspace(*flagarg)) {
-            flagarg++;
-            continue;
-        }
-        /* strtod(3) accepts ".95" as well as "0.95" so support that */
-        if (*flagarg != '+' && *flagarg != '.' && *flagarg != '-'
-            && !isdigit(*flagarg))
-            errx(EX_DATAERR, "non-digit non-space character in -%c", flag);
-
-        errno = 0;
-        value = strtod(flagarg, &ep);
-
-        /* no movement on pointer. can be caused by " + " or such in the
-         * input. cannot do usual '\0' check as more numbers may follow,
-         * though do need some means to detect such cases */
-        if (flagarg == ep)
-            errx(EX_DATAERR, "could not parse double in -%c", flag);
-
-        if (errno == ERANGE)
-            errx(EX_DATAERR, "value for -%c is not a double", flag);
-        if (isfinite(min) && value < min)
+    goptfoo_ctx_init(&ctx);
+    ctx.cache_dir = getenv("GOPTFOO_CACHE");
+    if (goptfoo_parse_lods(&ctx, flagarg, min, max, items, &numi,
+                           list_min, list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_EMIN)
             errx(EX_DATAERR, "value for -%c is below min %g", flag, min);
-        if (isfinite(max) && value > max)
+        if (ctx.code == GOPTFOO_EMAX)
             errx(EX_DATAERR, "value for -%c is above max %g", flag, max);
-
-        (*items)[numi++] = value;
-
-        if (numi >= alloitems) {
-            alloitems <<= 1;
-            if (alloitems > list_max)
-                alloitems = list_max;
-
-            if ((*items =
-                 realloc(*items, (size_t) alloitems * sizeof(double))) == NULL)
-                err(EX_OSERR, "could not realloc() %ld doubles for -%c",
-                    alloitems, flag);
-        }
-        /* probably only relevant if numi bumps up against list_max or a
-         * cosmic ray upsized *numitems or who knows */
-        if (numi > alloitems)
-            errx(EX_OSERR, "too many values specified for -%c, need only %ld",
-                 flag, list_max);
-
-        flagarg = ep;
+        list_errx(&ctx, flag, flagarg, "double", sizeof(double), list_min,
+                  list_max);
     }
 
-    if (list_min > 0 && numi < list_min)
-        errx(EX_DATAERR, "too few values specified for -%c, need %ld", flag,
-             list_min);
-
     if (numitems)
         *numitems = numi;
 
@@ -268,79 +6434,166 @@ size_t flagtololls(const int flag, const char *flagarg,
                    long long **items, size_t * numitems,
                    const size_t list_min, size_t list_max)
 {
-    char *ep;
-    long long value;
-    size_t alloitems = 8;       /* arbitrary starting point */
-    size_t numi = 0;
+    struct goptfoo_ctx ctx;
+    size_t numi = numitems ? *numitems : 0;
 
-    if (!flagarg || *flagarg == '\0')
-        errx(EX_DATAERR, "flag -%c value not set", flag);
+    goptfoo_ctx_init(&ctx);
+    ctx.cache_dir = getenv("GOPTFOO_CACHE");
+    if (goptfoo_parse_lolls(&ctx, flagarg, min, max, items, &numi,
+                            list_min, list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %lld", flag, min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %lld", flag, max);
+        list_errx(&ctx, flag, flagarg, "long long", sizeof(long long),
+                  list_min, list_max);
+    }
+
+    if (numitems)
+        *numitems = numi;
 
-    if (list_max > SIZE_MAX / sizeof(long long))
-        errx(EX_DATAERR, "list_max %lu too large for long long", list_max);
-    else if (list_max == 0)
-        list_max = SIZE_MAX / sizeof(long long);
+    return numi;
+}
 
-    if (numitems) {
-        if (*numitems > list_max) {
-            errx(EX_DATAERR, "too many items in list already");
-        } else if (*numitems > 0) {
-            alloitems = *numitems << 1;
-        }
-        numi = *numitems;
+size_t flagtolouls(const int flag, const char *flagarg,
+                   const unsigned long min, const unsigned long max,
+                   unsigned long **items, size_t * numitems,
+                   const size_t list_min, size_t list_max)
+{
+    struct goptfoo_ctx ctx;
+    size_t numi = numitems ? *numitems : 0;
+
+    goptfoo_ctx_init(&ctx);
+    ctx.cache_dir = getenv("GOPTFOO_CACHE");
+    if (goptfoo_parse_louls(&ctx, flagarg, min, max, items, &numi,
+                            list_min, list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_ECHAR)
+            errx(EX_DATAERR,
+                 "non-positive integer non-space character found in -%c",
+                 flag);
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %lu", flag, min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %lu", flag, max);
+        list_errx(&ctx, flag, flagarg, "unsigned long",
+                  sizeof(unsigned long), list_min, list_max);
     }
 
-    if (alloitems > list_max || (alloitems << 2) > list_max)
-        alloitems = list_max;
+    if (numitems)
+        *numitems = numi;
 
-    if ((*items = realloc(*items, alloitems * sizeof(long long))) == NULL)
-        err(EX_OSERR, "could not realloc() %ld long longs for -%c", alloitems,
-            flag);
+    return numi;
+}
 
-    while (*flagarg != '\0') {
-        if (isspace(*flagarg)) {
-            flagarg++;
-            continue;
-        }
-        if (*flagarg != '+' && *flagarg != '-' && !isdigit(*flagarg))
-            errx(EX_DATAERR, "non-digit non-space character in -%c", flag);
+size_t flagtolofs(const int flag, const char *flagarg,
+                  const float min, const float max,
+                  float **items, size_t * numitems,
+                  const size_t list_min, size_t list_max)
+{
+    struct goptfoo_ctx ctx;
+    size_t numi = numitems ? *numitems : 0;
 
-        errno = 0;
-        value = strtoll(flagarg, &ep, 0);
+    goptfoo_ctx_init(&ctx);
+    ctx.cache_dir = getenv("GOPTFOO_CACHE");
+    if (goptfoo_parse_lofs(&ctx, flagarg, min, max, items, &numi,
+                           list_min, list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %g", flag,
+                 (double) min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %g", flag,
+                 (double) max);
+        list_errx(&ctx, flag, flagarg, "float", sizeof(float), list_min,
+                  list_max);
+    }
 
-        if (flagarg == ep)
-            errx(EX_DATAERR, "could not parse long long in -%c", flag);
+    if (numitems)
+        *numitems = numi;
 
-        if (errno == ERANGE && (value == LLONG_MIN || value == LLONG_MAX))
-            errx(EX_DATAERR, "value for -%c is not a long long", flag);
-        if (min != LLONG_MIN && value < min)
-            errx(EX_DATAERR, "value for -%c is below min %lld", flag, min);
-        if (max != LLONG_MAX && value > max)
-            errx(EX_DATAERR, "value for -%c is above max %lld", flag, max);
+    return numi;
+}
 
-        (*items)[numi++] = value;
+size_t flagtoloi32s(const int flag, const char *flagarg,
+                    const int32_t min, const int32_t max,
+                    int32_t **items, size_t * numitems,
+                    const size_t list_min, size_t list_max)
+{
+    struct goptfoo_ctx ctx;
+    size_t numi = numitems ? *numitems : 0;
 
-        if (numi >= alloitems) {
-            alloitems <<= 1;
-            if (alloitems > list_max)
-                alloitems = list_max;
+    goptfoo_ctx_init(&ctx);
+    ctx.cache_dir = getenv("GOPTFOO_CACHE");
+    if (goptfoo_parse_loi32s(&ctx, flagarg, min, max, items, &numi,
+                             list_min, list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %lld", flag,
+                 (long long) min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %lld", flag,
+                 (long long) max);
+        list_errx(&ctx, flag, flagarg, "int32_t", sizeof(int32_t), list_min,
+                  list_max);
+    }
 
-            if ((*items =
-                 realloc(*items,
-                         (size_t) alloitems * sizeof(long long))) == NULL)
-                err(EX_OSERR, "could not realloc() %ld long longs for -%c",
-                    alloitems, flag);
-        }
-        if (numi > alloitems)
-            errx(EX_OSERR, "too many values specified for -%c, need only %ld",
-                 flag, list_max);
+    if (numitems)
+        *numitems = numi;
+
+    return numi;
+}
 
-        flagarg = ep;
+size_t flagtoloi16s(const int flag, const char *flagarg,
+                    const int16_t min, const int16_t max,
+                    int16_t **items, size_t * numitems,
+                    const size_t list_min, size_t list_max)
+{
+    struct goptfoo_ctx ctx;
+    size_t numi = numitems ? *numitems : 0;
+
+    goptfoo_ctx_init(&ctx);
+    ctx.cache_dir = getenv("GOPTFOO_CACHE");
+    if (goptfoo_parse_loi16s(&ctx, flagarg, min, max, items, &numi,
+                             list_min, list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %lld", flag,
+                 (long long) min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %lld", flag,
+                 (long long) max);
+        list_errx(&ctx, flag, flagarg, "int16_t", sizeof(int16_t), list_min,
+                  list_max);
     }
 
-    if (list_min > 0 && numi < list_min)
-        errx(EX_DATAERR, "too few values specified for -%c, need %ld", flag,
-             list_min);
+    if (numitems)
+        *numitems = numi;
+
+    return numi;
+}
+
+size_t flagtolou32s(const int flag, const char *flagarg,
+                    const uint32_t min, const uint32_t max,
+                    uint32_t **items, size_t * numitems,
+                    const size_t list_min, size_t list_max)
+{
+    struct goptfoo_ctx ctx;
+    size_t numi = numitems ? *numitems : 0;
+
+    goptfoo_ctx_init(&ctx);
+    ctx.cache_dir = getenv("GOPTFOO_CACHE");
+    if (goptfoo_parse_lou32s(&ctx, flagarg, min, max, items, &numi,
+                             list_min, list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_ECHAR)
+            errx(EX_DATAERR,
+                 "non-positive integer non-space character found in -%c",
+                 flag);
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %lu", flag,
+                 (unsigned long) min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %lu", flag,
+                 (unsigned long) max);
+        list_errx(&ctx, flag, flagarg, "uint32_t", sizeof(uint32_t), list_min,
+                  list_max);
+    }
 
     if (numitems)
         *numitems = numi;
@@ -348,89 +6601,274 @@ size_t flagtololls(const int flag, const char *flagarg,
     return numi;
 }
 
-size_t flagtolouls(const int flag, const char *flagarg,
-                   const unsigned long min, const unsigned long max,
-                   unsigned long **items, size_t * numitems,
+size_t flagtolou8s(const int flag, const char *flagarg,
+                   const uint8_t min, const uint8_t max,
+                   uint8_t **items, size_t * numitems,
                    const size_t list_min, size_t list_max)
 {
-    char *ep;
-    unsigned long value;
-    size_t alloitems = 8;       /* arbitrary starting point */
-    size_t numi = 0;
+    struct goptfoo_ctx ctx;
+    size_t numi = numitems ? *numitems : 0;
 
-    if (!flagarg || *flagarg == '\0')
-        errx(EX_DATAERR, "flag -%c value not set", flag);
+    goptfoo_ctx_init(&ctx);
+    ctx.cache_dir = getenv("GOPTFOO_CACHE");
+    if (goptfoo_parse_lou8s(&ctx, flagarg, min, max, items, &numi,
+                            list_min, list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_ECHAR)
+            errx(EX_DATAERR,
+                 "non-positive integer non-space character found in -%c",
+                 flag);
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %lu", flag,
+                 (unsigned long) min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %lu", flag,
+                 (unsigned long) max);
+        list_errx(&ctx, flag, flagarg, "uint8_t", sizeof(uint8_t), list_min,
+                  list_max);
+    }
+
+    if (numitems)
+        *numitems = numi;
+
+    return numi;
+}
 
-    if (list_max > SIZE_MAX / sizeof(unsigned long))
-        errx(EX_DATAERR, "list_max %lu too large for unsigned long", list_max);
-    else if (list_max == 0)
-        list_max = SIZE_MAX / sizeof(unsigned long);
+size_t flagtoset(const int flag, const char *flagarg,
+                 const unsigned long min, const unsigned long max,
+                 struct goptfoo_set *set, const size_t list_min,
+                 size_t list_max)
+{
+    struct goptfoo_ctx ctx;
 
-    if (numitems) {
-        if (*numitems > list_max) {
-            errx(EX_DATAERR, "too many items in list already");
-        } else if (*numitems > 0) {
-            alloitems = *numitems << 1;
+    goptfoo_ctx_init(&ctx);
+    if (goptfoo_parse_set(&ctx, flagarg, min, max, set, list_min,
+                          list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_ECHAR)
+            errx(EX_DATAERR,
+                 "non-positive integer non-space character found in -%c",
+                 flag);
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %lu", flag, min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %lu", flag, max);
+        if (ctx.code == GOPTFOO_ENOMEM) {
+            errno = ctx.oserr;
+            err(EX_OSERR, "could not add to set for -%c", flag);
         }
-        numi = *numitems;
+        list_errx(&ctx, flag, flagarg, "unsigned long",
+                  sizeof(unsigned long), list_min, list_max);
+    }
+
+    return set->count;
+}
+
+/* the exiting versions; a ragged matrix is reported with the number of
+ * values read up to the separator at fault */
+static void mat_errx(const struct goptfoo_ctx *ctx, const int flag,
+                     const char *flagarg, const char *tname,
+                     const size_t size)
+{
+    if (ctx->code == GOPTFOO_ESHAPE)
+        errx(EX_DATAERR, "ragged or empty row in -%c after %lu values",
+             flag, ctx->index);
+    list_errx(ctx, flag, flagarg, tname, size, 0, 0);
+}
+
+size_t flagtomatd(const int flag, const char *flagarg,
+                  const double min, const double max,
+                  struct goptfoo_matrix *matrix)
+{
+    struct goptfoo_ctx ctx;
+
+    goptfoo_ctx_init(&ctx);
+    if (goptfoo_parse_matrix_d(&ctx, flagarg, min, max, matrix)
+        != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %g", flag, min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %g", flag, max);
+        mat_errx(&ctx, flag, flagarg, "double", sizeof(double));
     }
 
-    if (alloitems > list_max || (alloitems << 2) > list_max)
-        alloitems = list_max;
+    return matrix->numitems;
+}
 
-    if ((*items = realloc(*items, alloitems * sizeof(unsigned long))) == NULL)
-        err(EX_OSERR, "could not realloc() %ld unsigned longs for -%c",
-            alloitems, flag);
+size_t flagtomatll(const int flag, const char *flagarg,
+                   const long long min, const long long max,
+                   struct goptfoo_matrix *matrix)
+{
+    struct goptfoo_ctx ctx;
 
-    while (*flagarg != '\0') {
-        if (isspace(*flagarg)) {
-            flagarg++;
-            continue;
-        }
+    goptfoo_ctx_init(&ctx);
+    if (goptfoo_parse_matrix_ll(&ctx, flagarg, min, max, matrix)
+        != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %lld", flag, min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %lld", flag, max);
+        mat_errx(&ctx, flag, flagarg, "long long", sizeof(long long));
+    }
 
-        if (*flagarg != '+' && !isdigit(*flagarg))
-            errx(EX_DATAERR,
-                 "non-positive integer non-space character found in -%c", flag);
+    return matrix->numitems;
+}
 
-        errno = 0;
-        value = strtoul(flagarg, &ep, 0);
+size_t flagtosummary(const int flag, const char *flagarg,
+                     const double min, const double max,
+                     struct goptfoo_summary *summary,
+                     const size_t list_min, size_t list_max)
+{
+    struct goptfoo_ctx ctx;
+    size_t count = summary->count;
 
-        if (flagarg == ep)
-            errx(EX_DATAERR, "could not parse unsigned long in -%c", flag);
+    goptfoo_ctx_init(&ctx);
+    if (goptfoo_reduce_lods(&ctx, flagarg, min, max, summary, list_min,
+                            list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %g", flag, min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %g", flag, max);
+        list_errx(&ctx, flag, flagarg, "double", sizeof(double), list_min,
+                  list_max);
+    }
 
-        if (errno == ERANGE && value == ULONG_MAX)
-            errx(EX_DATAERR, "value for -%c is not an unsigned long", flag);
-        if (min != 0 && value < min)
-            errx(EX_DATAERR, "value for -%c is below min %lu", flag, min);
-        if (max != ULONG_MAX && value > max)
-            errx(EX_DATAERR, "value for -%c is above max %lu", flag, max);
+    return summary->count - count;
+}
 
-        (*items)[numi++] = value;
+/* the exiting versions; bad entries and duplicate keys are shown as
+ * given */
+static void kv_errx(const struct goptfoo_ctx *ctx, const int flag,
+                    const char *flagarg, const char *tname,
+                    const size_t size, const size_t list_min,
+                    size_t list_max)
+{
+    if (ctx->code == GOPTFOO_EKEY)
+        errx(EX_DATAERR, "entry '%s' in -%c is not key=value", ctx->token,
+             flag);
+    if (ctx->code == GOPTFOO_EDUPKEY)
+        errx(EX_DATAERR, "duplicate key in '%s' for -%c", ctx->token, flag);
+    if (ctx->code == GOPTFOO_ENOMEM && ctx->index == 0) {
+        errno = ctx->oserr;
+        err(EX_OSERR, "could not copy keys for -%c", flag);
+    }
+    list_errx(ctx, flag, flagarg, tname, size, list_min, list_max);
+}
 
-        if (numi >= alloitems) {
-            alloitems <<= 1;
-            if (alloitems > list_max)
-                alloitems = list_max;
+size_t flagtokvd(const int flag, const char *flagarg,
+                 const double min, const double max,
+                 struct goptfoo_kv *kv, const size_t list_min,
+                 size_t list_max)
+{
+    struct goptfoo_ctx ctx;
 
-            if ((*items =
-                 realloc(*items,
-                         (size_t) alloitems * sizeof(unsigned long))) == NULL)
-                err(EX_OSERR, "could not realloc() %ld unsigned longs for -%c",
-                    alloitems, flag);
-        }
-        if (numi > alloitems)
-            errx(EX_OSERR, "too many values specified for -%c, need only %ld",
-                 flag, list_max);
+    goptfoo_ctx_init(&ctx);
+    if (goptfoo_parse_kv_d(&ctx, flagarg, min, max, kv, list_min,
+                           list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %g", flag, min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %g", flag, max);
+        kv_errx(&ctx, flag, flagarg, "double", sizeof(double), list_min,
+                list_max);
+    }
+
+    return kv->numitems;
+}
+
+size_t flagtokvll(const int flag, const char *flagarg,
+                  const long long min, const long long max,
+                  struct goptfoo_kv *kv, const size_t list_min,
+                  size_t list_max)
+{
+    struct goptfoo_ctx ctx;
 
-        flagarg = ep;
+    goptfoo_ctx_init(&ctx);
+    if (goptfoo_parse_kv_ll(&ctx, flagarg, min, max, kv, list_min,
+                            list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %lld", flag, min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %lld", flag, max);
+        kv_errx(&ctx, flag, flagarg, "long long", sizeof(long long),
+                list_min, list_max);
     }
 
-    if (list_min > 0 && numi < list_min)
-        errx(EX_DATAERR, "too few values specified for -%c, need %ld", flag,
-             list_min);
+    return kv->numitems;
+}
 
-    if (numitems)
-        *numitems = numi;
+size_t flagtokvul(const int flag, const char *flagarg,
+                  const unsigned long min, const unsigned long max,
+                  struct goptfoo_kv *kv, const size_t list_min,
+                  size_t list_max)
+{
+    struct goptfoo_ctx ctx;
 
-    return numi;
+    goptfoo_ctx_init(&ctx);
+    if (goptfoo_parse_kv_ul(&ctx, flagarg, min, max, kv, list_min,
+                            list_max) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_ENEGATIVE)
+            errx(EX_DATAERR, "value for -%c must be positive", flag);
+        if (ctx.code == GOPTFOO_EMIN)
+            errx(EX_DATAERR, "value for -%c is below min %lu", flag, min);
+        if (ctx.code == GOPTFOO_EMAX)
+            errx(EX_DATAERR, "value for -%c is above max %lu", flag, max);
+        kv_errx(&ctx, flag, flagarg, "unsigned long",
+                sizeof(unsigned long), list_min, list_max);
+    }
+
+    return kv->numitems;
+}
+
+/* argvtoopts ********************************************************* */
+
+/* the option of an error as the user would have typed it */
+static const char *opt_name(const struct goptfoo_opt *o, char *buf,
+                            const size_t len)
+{
+    if (o->longname)
+        snprintf(buf, len, "--%s", o->longname);
+    else
+        snprintf(buf, len, "-%c", o->shortname);
+    return buf;
+}
+
+int argvtoopts(const struct goptfoo_opt *table, const size_t count,
+               int argc, char *argv[])
+{
+    struct goptfoo_ctx ctx;
+    struct goptfoo_opts opts;
+    char name[64];
+
+    goptfoo_ctx_init(&ctx);
+    if (goptfoo_opts_init(&ctx, &opts, table, count) != GOPTFOO_OK) {
+        if (ctx.code == GOPTFOO_ENOMEM) {
+            errno = ctx.oserr;
+            err(EX_OSERR, "could not index options");
+        }
+        errx(EX_SOFTWARE, "bad option table entry %lu", ctx.index);
+    }
+    if (goptfoo_opts_parse(&ctx, &opts, argc, argv) != GOPTFOO_OK) {
+        switch (ctx.code) {
+        case GOPTFOO_EOPTION:
+            errx(EX_USAGE, "unknown option %s%s",
+                 ctx.token[0] == '-' ? "" : "-", ctx.token);
+        case GOPTFOO_EOPTARG:
+            errx(EX_USAGE, "option %s %s",
+                 opt_name(opts.opt, name, sizeof(name)),
+                 opts.opt->type == GOPTFOO_OPT_FLAG ? "takes no value"
+                 : "requires a value");
+        case GOPTFOO_ENOMEM:
+            errno = ctx.oserr;
+            err(EX_OSERR, "could not allocate for %s",
+                opt_name(opts.opt, name, sizeof(name)));
+        case GOPTFOO_EFILE:
+            errno = ctx.oserr;
+            err(EX_NOINPUT, "could not read @file for %s",
+                opt_name(opts.opt, name, sizeof(name)));
+        default:
+            errx(EX_DATAERR, "%s for %s at '%s'", goptfoo_strerror(ctx.code),
+                 opt_name(opts.opt, name, sizeof(name)), ctx.token);
+        }
+    }
+    goptfoo_opts_free(&opts);
+    return opts.optind;
 }
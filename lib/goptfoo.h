@@ -19,6 +19,12 @@
 #include <sysexits.h>
 #include <unistd.h>
 
+// the library is built with hidden visibility where the compiler has
+// it, so that only what is declared here is exported
+#if defined(__GNUC__) && __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
 // non-option named arguments (from argv[1] or similar)
 double argtod(const char *argname, const char *arg, const double min,
                      const double max);
@@ -27,6 +33,17 @@ long long argtoll(const char *argname, const char *arg, const long long min,
 unsigned long argtoul(const char *argname, const char *arg,
                       const unsigned long min, const unsigned long max);
 
+// every argument of argv[0..argc) (such as argv + optind after
+// getopt) into a new array of argc values; returns argc
+size_t argvtods(const char *argname, int argc, char *argv[],
+                const double min, const double max, double **items);
+size_t argvtolls(const char *argname, int argc, char *argv[],
+                 const long long min, const long long max,
+                 long long **items);
+size_t argvtouls(const char *argname, int argc, char *argv[],
+                 const unsigned long min, const unsigned long max,
+                 unsigned long **items);
+
 // single value calls for -f 0.21 or -k 5
 double flagtod(const int flag, const char *flagarg,
                const double min, const double max);
@@ -39,7 +56,8 @@ unsigned long flagtoul(const int flag, const char *flagarg,
  * cast if you do need a float. also note that 32-bit floats are
  * somewhat inaccurate and start confusing integers as low as 16777216 */
 
-// list of values -d '5 4 9 3' to be populated into the supplied **items
+// list of values -d '5 4 9 3' to be populated into the supplied **items,
+// or from a file with -d @path or standard input with -d @-
 size_t flagtolods(const int flag, const char *flagarg,
                   const double min, const double max,
                   double **items, size_t * numitems,
@@ -53,4 +71,774 @@ size_t flagtolouls(const int flag, const char *flagarg,
                    unsigned long **items, size_t * numitems,
                    const size_t list_min, size_t list_max);
 
+// the same for the narrower types, which are checked against the range
+// of the type as well as min and max. floats are rounded from the text
+// as strtof(3) would, not by way of a double
+size_t flagtolofs(const int flag, const char *flagarg,
+                  const float min, const float max,
+                  float **items, size_t * numitems,
+                  const size_t list_min, size_t list_max);
+size_t flagtoloi32s(const int flag, const char *flagarg,
+                    const int32_t min, const int32_t max,
+                    int32_t **items, size_t * numitems,
+                    const size_t list_min, size_t list_max);
+size_t flagtoloi16s(const int flag, const char *flagarg,
+                    const int16_t min, const int16_t max,
+                    int16_t **items, size_t * numitems,
+                    const size_t list_min, size_t list_max);
+size_t flagtolou32s(const int flag, const char *flagarg,
+                    const uint32_t min, const uint32_t max,
+                    uint32_t **items, size_t * numitems,
+                    const size_t list_min, size_t list_max);
+size_t flagtolou8s(const int flag, const char *flagarg,
+                   const uint8_t min, const uint8_t max,
+                   uint8_t **items, size_t * numitems,
+                   const size_t list_min, size_t list_max);
+
+/* non-exiting versions of the above for use in long-running programs.
+ * these return GOPTFOO_OK or one of the GOPTFOO_E* codes, and fill in
+ * the caller-owned context with the details of any error. the only
+ * global state they use is the memory budget, kept atomically, and the
+ * default allocator, so threads may parse in parallel with their own
+ * contexts */
+
+enum {
+    GOPTFOO_OK = 0,
+    GOPTFOO_ENOTSET,            // NULL or empty input
+    GOPTFOO_ENEGATIVE,          // negative value for an unsigned type
+    GOPTFOO_ECHAR,              // non-digit non-space character in list
+    GOPTFOO_EPARSE,             // could not parse the value
+    GOPTFOO_ERANGE,             // value does not fit the type
+    GOPTFOO_EMIN,               // value below min
+    GOPTFOO_EMAX,               // value above max
+    GOPTFOO_ETOOFEW,            // fewer than list_min values
+    GOPTFOO_ETOOMANY,           // more than list_max values
+    GOPTFOO_ELISTMAX,           // list_max too large for the type
+    GOPTFOO_EPREFILL,           // *numitems already above list_max
+    GOPTFOO_ENOMEM,             // allocation failed
+    GOPTFOO_EFILE,              // could not open or read an @file
+    GOPTFOO_ESTOPPED,           // callback returned non-zero
+    GOPTFOO_EFORMAT,            // @bin: format or file size is wrong
+    GOPTFOO_EOPTION,            // unknown option
+    GOPTFOO_EOPTARG,            // option value missing or not wanted
+    GOPTFOO_ETABLE,             // bad or duplicate option table entry
+    GOPTFOO_ESHAPE,             // ragged rows or an empty row in a matrix
+    GOPTFOO_EKEY,               // entry not key=value, or the key is empty
+    GOPTFOO_EDUPKEY,            // key given more than once
+    GOPTFOO_EBUDGET,            // list would go over the memory budget
+};
+
+#define GOPTFOO_TOKEN_MAX 32
+
+// ctx->flags
+#define GOPTFOO_EXACT 1         // size list allocations exactly
+#define GOPTFOO_RANGES 2        // "a-b:step" and "a:b:n" in lists
+#define GOPTFOO_DEC 4           // integers in decimal only
+#define GOPTFOO_HEX 8           // integers in hex only, 0x optional
+
+// default ctx->thread_min
+#define GOPTFOO_THREAD_MIN 1048576
+
+struct goptfoo_alloc;
+
+struct goptfoo_ctx {
+    unsigned int flags;         // GOPTFOO_EXACT and such options
+    unsigned int threads;       // parse large lists with this many
+    size_t thread_min;          // but only for inputs of this many bytes
+    const char *cache_dir;      // keep parsed lists here, or NULL
+    const struct goptfoo_alloc *alloc;  // for list items, or NULL
+    int code;                   // GOPTFOO_E* of the last call
+    int oserr;                  // errno for GOPTFOO_ENOMEM, _EFILE
+    size_t offset;              // of the offending token in the input
+    size_t index;               // list position of that token
+    char token[GOPTFOO_TOKEN_MAX];      // (start of) the offending token
+};
+
+union goptfoo_value {
+    double d;
+    long long ll;
+    unsigned long ul;
+};
+
+// count values from first to last, step apart for the integer types,
+// or evenly spaced for doubles; from "a-b", "a-b:step", or "a:b:n"
+struct goptfoo_range {
+    int type;
+    int down;                   // values descend from first
+    union goptfoo_value first, last;
+    unsigned long step;
+    size_t count;
+};
+
+// state of a list being iterated over; set up by goptfoo_iter_*
+struct goptfoo_iter {
+    struct goptfoo_ctx *ctx;
+    unsigned int flags;
+    int type;
+    union goptfoo_value min, max;
+    const char *base;
+    const char *p;
+    const char *end;
+    const char *tok;
+    size_t index;
+    struct goptfoo_range range; // being iterated over
+    size_t ri;                  // next value of the range
+};
+
+void goptfoo_ctx_init(struct goptfoo_ctx *ctx);
+const char *goptfoo_strerror(int code);
+
+int goptfoo_parse_d(struct goptfoo_ctx *ctx, const char *arg,
+                    const double min, const double max, double *value);
+int goptfoo_parse_ll(struct goptfoo_ctx *ctx, const char *arg,
+                     const long long min, const long long max,
+                     long long *value);
+int goptfoo_parse_ul(struct goptfoo_ctx *ctx, const char *arg,
+                     const unsigned long min, const unsigned long max,
+                     unsigned long *value);
+
+// each of argv[0..argc) as goptfoo_parse_* would, into a new array of
+// argc values (at least one is allocated) that is NULL on error, when
+// ctx->index is that of the argument at fault
+int goptfoo_parse_argv_d(struct goptfoo_ctx *ctx, int argc, char *argv[],
+                         const double min, const double max,
+                         double **items);
+int goptfoo_parse_argv_ll(struct goptfoo_ctx *ctx, int argc, char *argv[],
+                          const long long min, const long long max,
+                          long long **items);
+int goptfoo_parse_argv_ul(struct goptfoo_ctx *ctx, int argc, char *argv[],
+                          const unsigned long min,
+                          const unsigned long max, unsigned long **items);
+
+// a single value or range, not expanded; goptfoo_range_* then give
+// value i of it
+int goptfoo_parse_range_d(struct goptfoo_ctx *ctx, const char *arg,
+                          const double min, const double max,
+                          struct goptfoo_range *range);
+int goptfoo_parse_range_ll(struct goptfoo_ctx *ctx, const char *arg,
+                           const long long min, const long long max,
+                           struct goptfoo_range *range);
+int goptfoo_parse_range_ul(struct goptfoo_ctx *ctx, const char *arg,
+                           const unsigned long min,
+                           const unsigned long max,
+                           struct goptfoo_range *range);
+double goptfoo_range_d(const struct goptfoo_range *range, size_t i);
+long long goptfoo_range_ll(const struct goptfoo_range *range, size_t i);
+unsigned long goptfoo_range_ul(const struct goptfoo_range *range,
+                               size_t i);
+
+// unlike with flagtolo*s numitems must not be NULL
+int goptfoo_parse_lods(struct goptfoo_ctx *ctx, const char *arg,
+                       const double min, const double max,
+                       double **items, size_t * numitems,
+                       const size_t list_min, size_t list_max);
+int goptfoo_parse_lolls(struct goptfoo_ctx *ctx, const char *arg,
+                        const long long min, const long long max,
+                        long long **items, size_t * numitems,
+                        const size_t list_min, size_t list_max);
+int goptfoo_parse_louls(struct goptfoo_ctx *ctx, const char *arg,
+                        const unsigned long min, const unsigned long max,
+                        unsigned long **items, size_t * numitems,
+                        const size_t list_min, size_t list_max);
+int goptfoo_parse_lofs(struct goptfoo_ctx *ctx, const char *arg,
+                       const float min, const float max,
+                       float **items, size_t * numitems,
+                       const size_t list_min, size_t list_max);
+int goptfoo_parse_loi32s(struct goptfoo_ctx *ctx, const char *arg,
+                         const int32_t min, const int32_t max,
+                         int32_t **items, size_t * numitems,
+                         const size_t list_min, size_t list_max);
+int goptfoo_parse_loi16s(struct goptfoo_ctx *ctx, const char *arg,
+                         const int16_t min, const int16_t max,
+                         int16_t **items, size_t * numitems,
+                         const size_t list_min, size_t list_max);
+int goptfoo_parse_lou32s(struct goptfoo_ctx *ctx, const char *arg,
+                         const uint32_t min, const uint32_t max,
+                         uint32_t **items, size_t * numitems,
+                         const size_t list_min, size_t list_max);
+int goptfoo_parse_lou8s(struct goptfoo_ctx *ctx, const char *arg,
+                        const uint8_t min, const uint8_t max,
+                        uint8_t **items, size_t * numitems,
+                        const size_t list_min, size_t list_max);
+
+// as the above, but into a fixed buffer of bufsize items
+int goptfoo_fill_lods(struct goptfoo_ctx *ctx, const char *arg,
+                      const double min, const double max, double *buf,
+                      const size_t bufsize, size_t * numitems,
+                      const size_t list_min);
+int goptfoo_fill_lolls(struct goptfoo_ctx *ctx, const char *arg,
+                       const long long min, const long long max,
+                       long long *buf, const size_t bufsize,
+                       size_t * numitems, const size_t list_min);
+int goptfoo_fill_louls(struct goptfoo_ctx *ctx, const char *arg,
+                       const unsigned long min, const unsigned long max,
+                       unsigned long *buf, const size_t bufsize,
+                       size_t * numitems, const size_t list_min);
+
+// walk the values of a list without allocating anything: set up the
+// iterator for the type, then goptfoo_iter_next returns 1 with the next
+// value (a pointer to a double, long long, or unsigned long), 0 at the
+// end of the list, or -1 with the error in the context. the iterators
+// take the list itself and not @path
+int goptfoo_iter_lods(struct goptfoo_ctx *ctx, struct goptfoo_iter *it,
+                      const char *arg, const double min, const double max);
+int goptfoo_iter_lolls(struct goptfoo_ctx *ctx, struct goptfoo_iter *it,
+                       const char *arg, const long long min,
+                       const long long max);
+int goptfoo_iter_louls(struct goptfoo_ctx *ctx, struct goptfoo_iter *it,
+                       const char *arg, const unsigned long min,
+                       const unsigned long max);
+int goptfoo_iter_next(struct goptfoo_iter *it, void *value);
+
+// or have fn called with each value, which may stop the list by
+// returning non-zero. these do accept @path
+int goptfoo_each_lods(struct goptfoo_ctx *ctx, const char *arg,
+                      const double min, const double max,
+                      int (*fn)(double value, void *data), void *data);
+int goptfoo_each_lolls(struct goptfoo_ctx *ctx, const char *arg,
+                       const long long min, const long long max,
+                       int (*fn)(long long value, void *data), void *data);
+int goptfoo_each_louls(struct goptfoo_ctx *ctx, const char *arg,
+                       const unsigned long min, const unsigned long max,
+                       int (*fn)(unsigned long value, void *data),
+                       void *data);
+
+// push parser for lists that arrive in pieces: start a stream, feed it
+// buffers as they are read, and finish it, which also frees it. tokens
+// may be split across buffers. items and numitems are only final after
+// goptfoo_stream_finish, and must stay valid until then
+struct goptfoo_stream;
+
+struct goptfoo_stream *goptfoo_stream_lods(struct goptfoo_ctx *ctx,
+                                           const double min,
+                                           const double max,
+                                           double **items,
+                                           size_t * numitems,
+                                           size_t list_max);
+struct goptfoo_stream *goptfoo_stream_lolls(struct goptfoo_ctx *ctx,
+                                            const long long min,
+                                            const long long max,
+                                            long long **items,
+                                            size_t * numitems,
+                                            size_t list_max);
+struct goptfoo_stream *goptfoo_stream_louls(struct goptfoo_ctx *ctx,
+                                            const unsigned long min,
+                                            const unsigned long max,
+                                            unsigned long **items,
+                                            size_t * numitems,
+                                            size_t list_max);
+int goptfoo_stream_feed(struct goptfoo_stream *stream, const char *buf,
+                        const size_t len);
+int goptfoo_stream_finish(struct goptfoo_stream *stream,
+                          const size_t list_min);
+
+// a read-only view of a list. given @bin:FORMAT:path in the native byte
+// order the values are used straight from a mapping of the file, and
+// are only checked against min and max; anything else is parsed or
+// copied into memory of its own. either way goptfoo_view_free releases
+// it, also after an error
+struct goptfoo_view {
+    const void *items;          // the values, of the type of the call
+    size_t numitems;
+    void *base;                 // mapping or allocation to release
+    size_t maplen;              // length of the mapping, if mapped
+    size_t bytes;               // of base, if allocated
+};
+
+int goptfoo_view_lods(struct goptfoo_ctx *ctx, const char *arg,
+                      const double min, const double max,
+                      struct goptfoo_view *view, const size_t list_min,
+                      size_t list_max);
+int goptfoo_view_lolls(struct goptfoo_ctx *ctx, const char *arg,
+                       const long long min, const long long max,
+                       struct goptfoo_view *view, const size_t list_min,
+                       size_t list_max);
+int goptfoo_view_louls(struct goptfoo_ctx *ctx, const char *arg,
+                       const unsigned long min, const unsigned long max,
+                       struct goptfoo_view *view, const size_t list_min,
+                       size_t list_max);
+void goptfoo_view_free(struct goptfoo_view *view);
+
+// check caller-held values against min and max as the list functions
+// do, but in bulk; the index of the first bad value is in ctx->index,
+// and NaN is an error (GOPTFOO_EPARSE)
+int goptfoo_check_lods(struct goptfoo_ctx *ctx, const double *items,
+                       const size_t numitems, const double min,
+                       const double max);
+int goptfoo_check_lolls(struct goptfoo_ctx *ctx, const long long *items,
+                        const size_t numitems, const long long min,
+                        const long long max);
+int goptfoo_check_louls(struct goptfoo_ctx *ctx, const unsigned long *items,
+                        const size_t numitems, const unsigned long min,
+                        const unsigned long max);
+int goptfoo_check_lofs(struct goptfoo_ctx *ctx, const float *items,
+                       const size_t numitems, const float min,
+                       const float max);
+int goptfoo_check_loi32s(struct goptfoo_ctx *ctx, const int32_t *items,
+                         const size_t numitems, const int32_t min,
+                         const int32_t max);
+int goptfoo_check_loi16s(struct goptfoo_ctx *ctx, const int16_t *items,
+                         const size_t numitems, const int16_t min,
+                         const int16_t max);
+int goptfoo_check_lou32s(struct goptfoo_ctx *ctx, const uint32_t *items,
+                         const size_t numitems, const uint32_t min,
+                         const uint32_t max);
+int goptfoo_check_lou8s(struct goptfoo_ctx *ctx, const uint8_t *items,
+                        const size_t numitems, const uint8_t min,
+                        const uint8_t max);
+
+// sets of unsigned IDs: a sparse set is a sorted array of its values;
+// once dense enough the values are kept in chunks of 65536, each a
+// sorted array or a bitmap depending on how many of its values are in
+// the set. order and duplicates do not matter, and membership is a hash
+// of the upper bits then a look within at most one chunk of values.
+// zero the set (or goptfoo_set_init it) before first use
+struct goptfoo_set_chunk;
+
+struct goptfoo_set {
+    unsigned long *values;      // while sparse (chunks is NULL)
+    size_t allocvalues;
+    struct goptfoo_set_chunk *chunks;
+    size_t numchunks;
+    size_t allochunks;
+    size_t count;               // distinct values in the set
+    uint32_t *index;            // upper bits to chunk or first value
+    size_t indexmask;
+    size_t indexkeys;
+};
+
+struct goptfoo_set_iter {
+    const struct goptfoo_set *set;
+    size_t chunk;
+    size_t pos;
+};
+
+void goptfoo_set_init(struct goptfoo_set *set);
+int goptfoo_parse_set(struct goptfoo_ctx *ctx, const char *arg,
+                      const unsigned long min, const unsigned long max,
+                      struct goptfoo_set *set, const size_t list_min,
+                      size_t list_max);
+int goptfoo_set_add(struct goptfoo_ctx *ctx, struct goptfoo_set *set,
+                    const unsigned long value);
+int goptfoo_set_has(const struct goptfoo_set *set,
+                    const unsigned long value);
+size_t goptfoo_set_count(const struct goptfoo_set *set);
+size_t goptfoo_set_bytes(const struct goptfoo_set *set);
+void goptfoo_set_iter(const struct goptfoo_set *set,
+                      struct goptfoo_set_iter *it);
+int goptfoo_set_next(struct goptfoo_set_iter *it, unsigned long *value);
+void goptfoo_set_free(struct goptfoo_set *set);
+
+// and the exiting version, which returns the count
+size_t flagtoset(const int flag, const char *flagarg,
+                 const unsigned long min, const unsigned long max,
+                 struct goptfoo_set *set, const size_t list_min,
+                 size_t list_max);
+
+// matrices: rows of a list separated by ';', planes by ';;', and so on
+// up to GOPTFOO_MAT_DIMS dimensions, as in -k '1 2 3; 4 5 6'. the values
+// are parsed into one contiguous row-major buffer aligned to (and padded
+// with zeros out to a multiple of) GOPTFOO_MAT_ALIGN bytes
+#define GOPTFOO_MAT_DIMS 4
+#define GOPTFOO_MAT_ALIGN 64
+
+struct goptfoo_matrix {
+    void *items;                // of the type of the call
+    size_t numitems;
+    size_t ndims;
+    size_t shape[GOPTFOO_MAT_DIMS];     // outermost dimension first
+    size_t stride[GOPTFOO_MAT_DIMS];    // in items, for each dimension
+    size_t bytes;               // of items, padding included
+};
+
+int goptfoo_parse_matrix_d(struct goptfoo_ctx *ctx, const char *arg,
+                           const double min, const double max,
+                           struct goptfoo_matrix *matrix);
+int goptfoo_parse_matrix_ll(struct goptfoo_ctx *ctx, const char *arg,
+                            const long long min, const long long max,
+                            struct goptfoo_matrix *matrix);
+void goptfoo_matrix_free(struct goptfoo_matrix *matrix);
+
+// and the exiting versions, which return the number of items
+size_t flagtomatd(const int flag, const char *flagarg,
+                  const double min, const double max,
+                  struct goptfoo_matrix *matrix);
+size_t flagtomatll(const int flag, const char *flagarg,
+                   const long long min, const long long max,
+                   struct goptfoo_matrix *matrix);
+
+// reducers: the count, min, max, compensated sum, mean, and variance of
+// a list, and optionally a histogram, worked out as the list is parsed
+// without keeping the values. zero the summary (or goptfoo_summary_init
+// it) before first use; further lists add to it
+struct goptfoo_summary {
+    size_t count;
+    union goptfoo_value min, max;       // of the type of the call
+    double sum;
+    double mean;
+    double m2;                  // sum of squared differences from the mean
+    double kahan[2];            // the sum and its running compensation
+    // histogram of nbins equal bins over [lo, hi), if bins is not NULL
+    double lo, hi;
+    size_t *bins;
+    size_t nbins;
+    size_t below, above;        // values outside [lo, hi), and NaN
+};
+
+void goptfoo_summary_init(struct goptfoo_summary *summary);
+void goptfoo_summary_hist(struct goptfoo_summary *summary,
+                          const double lo, const double hi, size_t *bins,
+                          const size_t nbins);
+double goptfoo_summary_var(const struct goptfoo_summary *summary);
+int goptfoo_reduce_lods(struct goptfoo_ctx *ctx, const char *arg,
+                        const double min, const double max,
+                        struct goptfoo_summary *summary,
+                        const size_t list_min, size_t list_max);
+int goptfoo_reduce_lolls(struct goptfoo_ctx *ctx, const char *arg,
+                         const long long min, const long long max,
+                         struct goptfoo_summary *summary,
+                         const size_t list_min, size_t list_max);
+int goptfoo_reduce_louls(struct goptfoo_ctx *ctx, const char *arg,
+                         const unsigned long min, const unsigned long max,
+                         struct goptfoo_summary *summary,
+                         const size_t list_min, size_t list_max);
+
+// and the exiting version, which returns the count of this list
+size_t flagtosummary(const int flag, const char *flagarg,
+                     const double min, const double max,
+                     struct goptfoo_summary *summary,
+                     const size_t list_min, size_t list_max);
+
+// key=value lists, as in -K 'shard7=0.25 shard9=0.5'. the keys are
+// copied NUL terminated into one arena and the values into an array of
+// the type of the call, both in input order, and an open addressing
+// index of the keys is built as they are parsed. a key may appear only
+// once. goptfoo_kv_free the kv when done with it
+struct goptfoo_kv_slot;
+
+struct goptfoo_kv {
+    char *arena;                // the keys, each NUL terminated
+    size_t *keys;               // offset of each key in the arena
+    void *values;               // of the type of the call
+    size_t numitems;
+    size_t allocitems;          // of values and keys
+    size_t size;                // of each value
+    struct goptfoo_kv_slot *index;
+    size_t mask;                // index slots - 1
+    size_t arenalen, allocarena;
+};
+
+int goptfoo_parse_kv_d(struct goptfoo_ctx *ctx, const char *arg,
+                       const double min, const double max,
+                       struct goptfoo_kv *kv, const size_t list_min,
+                       size_t list_max);
+int goptfoo_parse_kv_ll(struct goptfoo_ctx *ctx, const char *arg,
+                        const long long min, const long long max,
+                        struct goptfoo_kv *kv, const size_t list_min,
+                        size_t list_max);
+int goptfoo_parse_kv_ul(struct goptfoo_ctx *ctx, const char *arg,
+                        const unsigned long min, const unsigned long max,
+                        struct goptfoo_kv *kv, const size_t list_min,
+                        size_t list_max);
+// 1 and the item number in *i if key is present, else 0
+int goptfoo_kv_find(const struct goptfoo_kv *kv, const char *key,
+                    size_t *i);
+const char *goptfoo_kv_key(const struct goptfoo_kv *kv, const size_t i);
+void goptfoo_kv_free(struct goptfoo_kv *kv);
+
+// and the exiting versions, which return the number of items
+size_t flagtokvd(const int flag, const char *flagarg,
+                 const double min, const double max,
+                 struct goptfoo_kv *kv, const size_t list_min,
+                 size_t list_max);
+size_t flagtokvll(const int flag, const char *flagarg,
+                  const long long min, const long long max,
+                  struct goptfoo_kv *kv, const size_t list_min,
+                  size_t list_max);
+size_t flagtokvul(const int flag, const char *flagarg,
+                  const unsigned long min, const unsigned long max,
+                  struct goptfoo_kv *kv, const size_t list_min,
+                  size_t list_max);
+
+// list items are allocated with ctx->alloc where that is set, and any
+// items passed in must then have come from it too; goptfoo_ctx_init sets
+// it to what was last given to goptfoo_set_alloc, which is also what the
+// exiting functions use. realloc and free are as realloc(3) and free(3),
+// with the size in bytes. goptfoo_mmap_alloc gives each list its own
+// mapping, grown by mremap(2) where there is that, and asks for
+// transparent huge pages once it reaches GOPTFOO_HUGE_PAGE bytes
+#define GOPTFOO_HUGE_PAGE 2097152
+
+struct goptfoo_alloc {
+    void *(*realloc)(void *ptr, size_t size, void *data);
+    void (*free)(void *ptr, void *data);
+    void *data;
+};
+
+extern const struct goptfoo_alloc goptfoo_mmap_alloc;
+
+const struct goptfoo_alloc *goptfoo_set_alloc(const struct goptfoo_alloc
+                                              *alloc);
+// free list items from alloc (NULL for free(3)), giving bytes back to
+// the budget
+void goptfoo_free(const struct goptfoo_alloc *alloc, void *items,
+                  const size_t bytes);
+
+// a process-wide cap on the bytes allocated and not given back, 0 (the
+// default) for none; returns the previous cap. this counts list items,
+// and also the sets, matrices, key=value lists, option indexes, and read
+// buffers, which always come from realloc(3). with a cap the lists are
+// sized exactly, so that an input that would go over it fails with
+// GOPTFOO_EBUDGET before the items are allocated, and a list holds
+// numitems (at least one) times the item size in bytes. bytes are only
+// counted while there is a cap, so set it before anything is parsed;
+// taking the cap away zeroes the count
+size_t goptfoo_budget(const size_t bytes);
+size_t goptfoo_budget_used(void);
+
+// counters of the work done by the library, kept only when it is built
+// with --enable-stats; otherwise goptfoo_stats zeroes them and returns
+// -1. with GOPTFOO_STATS set in the environment they are printed to
+// standard error at exit
+enum {
+    GOPTFOO_STATS_ARG,          // argto*
+    GOPTFOO_STATS_FLAG,         // flagtod, flagtoll, flagtoul
+    GOPTFOO_STATS_LIST,         // flagtolo*s and all other lists
+    GOPTFOO_STATS_KINDS
+};
+
+struct goptfoo_counters {
+    uint64_t calls;
+    uint64_t bytes;             // of input scanned
+    uint64_t values;            // produced
+    uint64_t reallocs;          // of the list items
+    uint64_t realloc_bytes;
+    uint64_t cycles;            // TSC ticks on x86, else nanoseconds
+};
+
+int goptfoo_stats(struct goptfoo_counters counters[GOPTFOO_STATS_KINDS]);
+
+// option tables: each entry names a short and/or long option, the type
+// of its value, the bounds, and where to put it. goptfoo_opts_init
+// indexes the table, after which goptfoo_opts_parse reads argv in one
+// pass, handing each value to the matching goptfoo_parse_* function
+enum {
+    GOPTFOO_OPT_FLAG = 0,       // no value; the int *dest is incremented
+    GOPTFOO_OPT_STR,            // const char **dest is set to the value
+    GOPTFOO_OPT_D,
+    GOPTFOO_OPT_LL,
+    GOPTFOO_OPT_UL,
+    GOPTFOO_OPT_LODS,           // and for the lists, dest is the items
+    GOPTFOO_OPT_LOLLS,
+    GOPTFOO_OPT_LOULS,
+    GOPTFOO_OPT_LOFS,
+    GOPTFOO_OPT_LOI32S,
+    GOPTFOO_OPT_LOI16S,
+    GOPTFOO_OPT_LOU32S,
+    GOPTFOO_OPT_LOU8S,
+    GOPTFOO_OPT_SET,            // dest is a struct goptfoo_set
+};
+
+struct goptfoo_opt {
+    int shortname;              // 'd' for -d, or 0
+    const char *longname;       // "delay" for --delay, or NULL
+    int type;                   // GOPTFOO_OPT_*
+    union goptfoo_value min, max;       // .d, .ll, or .ul by type
+    size_t list_min, list_max;
+    void *dest;
+    size_t *numitems;           // for the lists
+};
+
+struct goptfoo_opts {
+    const struct goptfoo_opt *table;
+    size_t count;
+    int optind;                 // first operand, or the bad argument
+    const struct goptfoo_opt *opt;      // entry of the error, if known
+    size_t *byshort;            // the index, all in one allocation
+    size_t *disp;
+    size_t *slots;
+    size_t mask, bmask;
+};
+
+int goptfoo_opts_init(struct goptfoo_ctx *ctx, struct goptfoo_opts *opts,
+                      const struct goptfoo_opt *table, const size_t count);
+int goptfoo_opts_parse(struct goptfoo_ctx *ctx, struct goptfoo_opts *opts,
+                       int argc, char *argv[]);
+void goptfoo_opts_free(struct goptfoo_opts *opts);
+
+// or all at once, exiting on error; returns the index of the first
+// operand in argv
+int argvtoopts(const struct goptfoo_opt *table, const size_t count,
+               int argc, char *argv[]);
+
+#if defined(__GNUC__) && __GNUC__ >= 4
+#pragma GCC visibility pop
+#endif
+
+// with GOPTFOO_INLINE defined before this header is included, argto*
+// and flagto* of plain decimal input are parsed by inline code, so that
+// constant min and max fold away and the call into the library is left
+// for anything else: other bases, leading space, exponents, more digits
+// than surely fit, and all errors, which are reported as usual. the
+// inline path is not seen by the --enable-stats counters
+#ifdef GOPTFOO_INLINE
+#include <float.h>
+
+// at most n digits and nothing after them; a leading 0 is only allowed
+// alone as otherwise it is octal
+static inline int goptfoo_inline_digits(const char *p, const unsigned int n,
+                                        unsigned long long *value)
+{
+    unsigned long long v = 0;
+    unsigned int i;
+
+    if (p[0] == '0' && p[1] != '\0')
+        return 0;
+    for (i = 0; i < n && (unsigned char) (p[i] - '0') < 10; i++)
+        v = v * 10 + (unsigned int) (p[i] - '0');
+    if (i == 0 || p[i] != '\0')
+        return 0;
+    *value = v;
+    return 1;
+}
+
+static inline int goptfoo_inline_ll(const char *arg, const long long min,
+                                    const long long max, long long *value)
+{
+    unsigned long long v;
+    const int neg = arg && *arg == '-';
+
+    if (!arg || !goptfoo_inline_digits(arg + neg, 18, &v))
+        return 0;
+    *value = neg ? -(long long) v : (long long) v;
+    return *value >= min && *value <= max;
+}
+
+static inline int goptfoo_inline_ul(const char *arg,
+                                    const unsigned long min,
+                                    const unsigned long max,
+                                    unsigned long *value)
+{
+    unsigned long long v;
+
+    if (!arg || !goptfoo_inline_digits(arg, ULONG_MAX > 0xffffffffUL
+                                       ? 19 : 9, &v))
+        return 0;
+    *value = (unsigned long) v;
+    return *value >= min && *value <= max;
+}
+
+// up to 15 digits with an optional fraction make a mantissa that is
+// exact in a double, and one division by an exact power of ten then
+// rounds correctly, as the library would
+static inline int goptfoo_inline_d(const char *arg, const double min,
+                                   const double max, double *value)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    static const double pow10[16] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+        1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+    };
+    unsigned long long m = 0;
+    unsigned int digits = 0, frac = 0;
+    const char *p = arg;
+    int neg;
+
+    if (!p)
+        return 0;
+    neg = *p == '-';
+    p += neg;
+    if ((unsigned char) (*p - '0') >= 10)
+        return 0;
+    for (; (unsigned char) (*p - '0') < 10; p++, digits++)
+        m = m * 10 + (unsigned int) (*p - '0');
+    if (*p == '.')
+        for (p++; (unsigned char) (*p - '0') < 10; p++, digits++, frac++)
+            m = m * 10 + (unsigned int) (*p - '0');
+    if (*p != '\0' || digits > 15 || (p[-1] == '.'))
+        return 0;
+    *value = (double) m / pow10[frac];
+    if (neg)
+        *value = -*value;
+    return !(isfinite(min) && *value < min)
+        && !(isfinite(max) && *value > max);
+#else
+    (void) arg;
+    (void) min;
+    (void) max;
+    (void) value;
+    return 0;
+#endif
+}
+
+// the library functions are called as (name)(...) so that the macros
+// below do not apply to them
+static inline double goptfoo_inline_argtod(const char *argname,
+                                           const char *arg,
+                                           const double min,
+                                           const double max)
+{
+    double val;
+    return goptfoo_inline_d(arg, min, max, &val) ? val
+        : (argtod) (argname, arg, min, max);
+}
+
+static inline long long goptfoo_inline_argtoll(const char *argname,
+                                               const char *arg,
+                                               const long long min,
+                                               const long long max)
+{
+    long long val;
+    return goptfoo_inline_ll(arg, min, max, &val) ? val
+        : (argtoll) (argname, arg, min, max);
+}
+
+static inline unsigned long goptfoo_inline_argtoul(const char *argname,
+                                                   const char *arg,
+                                                   const unsigned long min,
+                                                   const unsigned long max)
+{
+    unsigned long val;
+    return goptfoo_inline_ul(arg, min, max, &val) ? val
+        : (argtoul) (argname, arg, min, max);
+}
+
+static inline double goptfoo_inline_flagtod(const int flag,
+                                            const char *flagarg,
+                                            const double min,
+                                            const double max)
+{
+    double val;
+    return goptfoo_inline_d(flagarg, min, max, &val) ? val
+        : (flagtod) (flag, flagarg, min, max);
+}
+
+static inline long long goptfoo_inline_flagtoll(const int flag,
+                                                const char *flagarg,
+                                                const long long min,
+                                                const long long max)
+{
+    long long val;
+    return goptfoo_inline_ll(flagarg, min, max, &val) ? val
+        : (flagtoll) (flag, flagarg, min, max);
+}
+
+static inline unsigned long goptfoo_inline_flagtoul(const int flag,
+                                                    const char *flagarg,
+                                                    const unsigned long min,
+                                                    const unsigned long max)
+{
+    unsigned long val;
+    return goptfoo_inline_ul(flagarg, min, max, &val) ? val
+        : (flagtoul) (flag, flagarg, min, max);
+}
+
+#define argtod(n, a, min, max) goptfoo_inline_argtod(n, a, min, max)
+#define argtoll(n, a, min, max) goptfoo_inline_argtoll(n, a, min, max)
+#define argtoul(n, a, min, max) goptfoo_inline_argtoul(n, a, min, max)
+#define flagtod(f, a, min, max) goptfoo_inline_flagtod(f, a, min, max)
+#define flagtoll(f, a, min, max) goptfoo_inline_flagtoll(f, a, min, max)
+#define flagtoul(f, a, min, max) goptfoo_inline_flagtoul(f, a, min, max)
+#endif
+
 #endif